@@ -0,0 +1,541 @@
+// fms_bench.cpp - Benchmarks for piecewise flat curves, pricing and bootstrapping.
+// Prints a JSON array of results to stdout. On Linux build from the top directory with
+//   make fms_bench/fms_bench
+// or from this directory with
+//   g++ -std=c++20 -O2 -DNDEBUG fms_bench.cpp ../fms_bootstrap/fms_alloc_count.cpp ../fms_bootstrap/fms_pwflat_file.cpp ../fms_bootstrap/fms_pwflat_shared.cpp -o fms_bench -lpthread
+// Usage: fms_bench [max_knots]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../fms_sequence/fms_sequence.h"
+#include "../fms_bootstrap/fms_alloc_count.h"
+#include "../fms_bootstrap/fms_bootstrap.h"
+#include "../fms_bootstrap/fms_bootstrap_async.h"
+#include "../fms_bootstrap/fms_bootstrap_book.h"
+#include "../fms_bootstrap/fms_bootstrap_pipeline.h"
+#include "../fms_bootstrap/fms_hull_white.h"
+#include "../fms_bootstrap/fms_instrument.h"
+#include "../fms_bootstrap/fms_pwflat.h"
+#include "../fms_bootstrap/fms_pwflat_compress.h"
+#include "../fms_bootstrap/fms_pwflat_file.h"
+#include "../fms_bootstrap/fms_pwflat_grid.h"
+#include "../fms_bootstrap/fms_pwflat_history.h"
+#include "../fms_bootstrap/fms_pwflat_plan.h"
+#include "../fms_bootstrap/fms_pwflat_roll.h"
+#include "../fms_bootstrap/fms_pwflat_shared.h"
+#include "../fms_bootstrap/fms_rcu.h"
+#include "../fms_bootstrap/fms_span.h"
+
+using fms::sequence::list;
+using curve = fms::pwflat::forward<list<double>, list<double>>;
+using instrument = fms::instrument::sequence<list<double>, list<double>>;
+
+// Keep the optimizer from discarding results.
+static volatile double sink;
+
+// First record starts the JSON array.
+static bool first = true;
+
+// Time ops calls of op() after one warm up call and print a JSON record.
+// If each call does work units of work the record is per unit.
+template<class Op>
+inline void bench(const char* name, const char* param, size_t n, size_t ops, Op op, size_t work = 1)
+{
+	op();
+	size_t a0 = fms::alloc::count;
+	auto t0 = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < ops; ++i) {
+		op();
+	}
+	auto t1 = std::chrono::steady_clock::now();
+	size_t a1 = fms::alloc::count;
+
+	ops *= work;
+	double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / ops;
+	printf("%s\n  {\"name\": \"%s\", \"%s\": %zu, \"ops\": %zu, \"ns_per_op\": %.1f, \"allocs_per_op\": %.2f, \"ops_per_sec\": %.0f}",
+		first ? "[" : ",", name, param, n, ops, ns, double(a1 - a0) / ops, 1e9 / ns);
+	first = false;
+}
+
+// Run op ops times on each of threads threads and print a JSON record of the combined rate.
+template<class Op>
+inline void bench_threads(const char* name, const char* param, size_t threads, size_t ops, Op op)
+{
+	std::atomic<size_t> ready = 0;
+	std::atomic<bool> go = false;
+	std::vector<std::thread> ts;
+	for (size_t k = 0; k < threads; ++k) {
+		ts.emplace_back([&, k]() {
+			op(k);
+			++ready;
+			while (!go) {
+				std::this_thread::yield();
+			}
+			for (size_t i = 0; i < ops; ++i) {
+				op(k);
+			}
+		});
+	}
+	while (ready < threads) {
+		std::this_thread::yield();
+	}
+	size_t a0 = fms::alloc::count;
+	auto t0 = std::chrono::steady_clock::now();
+	go = true;
+	for (auto& t : ts) {
+		t.join();
+	}
+	auto t1 = std::chrono::steady_clock::now();
+	size_t a1 = fms::alloc::count;
+	double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / (ops * threads);
+	printf("%s\n  {\"name\": \"%s\", \"%s\": %zu, \"ops\": %zu, \"ns_per_op\": %.1f, \"allocs_per_op\": %.2f, \"ops_per_sec\": %.0f}",
+		first ? "[" : ",", name, param, threads, ops * threads, ns, double(a1 - a0) / (ops * threads), 1e9 / ns);
+	first = false;
+}
+
+// Curve with n knots out to 30 years with forwards between 1% and 5%.
+inline curve make_curve(size_t n)
+{
+	list<double> t, f;
+
+	for (size_t i = 1; i <= n; ++i) {
+		t.push_back(30. * i / n);
+		f.push_back(0.01 + 0.04 * (i % 17) / 16);
+	}
+
+	return curve(t, f);
+}
+
+// Number of calls so each benchmark does about work operations per knot walk.
+inline size_t ops(size_t n, size_t work = 10'000'000)
+{
+	return std::max<size_t>(10, work / n);
+}
+
+// Strip of m instruments: cash deposits to 1 year, FRAs to 2 years, then annual swaps.
+inline std::vector<instrument> make_strip(size_t m)
+{
+	std::vector<instrument> is;
+
+	for (size_t k = 0; k < m; ++k) {
+		if (k < 4) {
+			is.push_back(fms::instrument::flows(fms::instrument::cash_deposit(0.25 * (k + 1), 0.02)));
+		}
+		else if (k < 8) {
+			is.push_back(fms::instrument::flows(fms::instrument::forward_rate_agreement(0.25 * k, 0.25, 0.025)));
+		}
+		else {
+			is.push_back(fms::instrument::flows(fms::instrument::interest_rate_swap(double(k - 5), 2, 0.03)));
+		}
+	}
+
+	return is;
+}
+
+int main(int argc, char* argv[])
+{
+	size_t max_knots = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1'000'000;
+
+	for (size_t n = 10; n <= max_knots; n *= 10) {
+		auto F = make_curve(n);
+		double u = 0;
+		auto next = [&u]() { u = u < 29 ? u + 0.7 : 0.1; return u; };
+
+		bench("pwflat::value", "knots", n, ops(n), [&]() { sink = fms::pwflat::value(next(), F.time(), F.rate()); });
+		bench("pwflat::integral", "knots", n, ops(n), [&]() { sink = fms::pwflat::integral(next(), F.time(), F.rate()); });
+		bench("forward::discount", "knots", n, ops(n), [&]() { sink = F.discount(next()); });
+
+		// same curve over contiguous memory
+		std::vector<double> t, f;
+		for (auto ti = F.time(); ti; ++ti) {
+			t.push_back(*ti);
+		}
+		for (auto fi = F.rate(); fi; ++fi) {
+			f.push_back(*fi);
+		}
+		fms::pwflat::forward S(fms::span<double>(n, t.data()), fms::span<double>(n, f.data()));
+		bench("forward::discount/span", "knots", n, ops(n), [&]() { sink = S.discount(next()); });
+
+		for (size_t q : { 100, 10'000 }) {
+			std::vector<double> us(q), v(q);
+			for (size_t i = 0; i < q; ++i) {
+				us[i] = 30. * (i + 0.5) / q;
+			}
+			fms::pwflat::plan p(F.time(), q, us.data());
+			std::string name = "plan::discount/" + std::to_string(q);
+			bench(name.c_str(), "knots", n, ops(n + q, 100'000'000), [&]() { p.discount(F, v.data()); sink = v[0]; });
+			name = "grid/" + std::to_string(q);
+			bench(name.c_str(), "knots", n, ops(n + q, 100'000'000), [&]() { fms::pwflat::grid(F, 0., 30. / q, q, nullptr, nullptr, v.data()); sink = v[0]; });
+		}
+	}
+
+	// compression of curves with forwards differing by a fraction of a basis point
+	for (size_t n = 1'000; n <= max_knots and n <= 100'000; n *= 10) {
+		list<double> t, f;
+		for (size_t i = 1; i <= n; ++i) {
+			t.push_back(30. * i / n);
+			f.push_back(0.03 + 0.00005 * std::sin(0.01 * i) + 0.0001 * (i % 7) / 6);
+		}
+		curve F(t, f);
+		double u = 0;
+		auto next = [&u]() { u = u < 29 ? u + 0.7 : 0.1; return u; };
+
+		bench("pwflat::compress", "knots", n, ops(n, 1'000'000), [&]() { sink = fms::pwflat::compress(F, 0, nullptr, 1e-6).value(1); });
+		auto G = fms::pwflat::compress(F, 0, nullptr, 1e-6);
+		size_t m = 0;
+		for (auto ti = G.time(); ti; ++ti) {
+			++m;
+		}
+		bench("forward::discount/compressed", "knots", m, ops(n), [&]() { sink = G.discount(next()); });
+	}
+
+	// discounts at 10 times past each of 360 monthly horizons
+	{
+		auto F = make_curve(100).extrapolate(0.05);
+		std::vector<double> s(360);
+		for (size_t k = 0; k < s.size(); ++k) {
+			s[k] = k / 12.;
+		}
+		bench("discount/ratio", "horizons", s.size(), 10, [&]() {
+			double x = 0;
+			for (double sk : s) {
+				double Ds = F.discount(sk);
+				for (int j = 1; j <= 10; ++j) {
+					x += F.discount(sk + j) / Ds;
+				}
+			}
+			sink = x;
+		}, s.size());
+		bench("pwflat::roll", "horizons", s.size(), 10, [&]() {
+			double x = 0;
+			for (const auto& G : fms::pwflat::roll(F, s.size(), s.data())) {
+				for (int j = 1; j <= 10; ++j) {
+					x += G.discount(j);
+				}
+			}
+			sink = x;
+		}, s.size());
+	}
+
+	// snapshot file of 1000 curves with 100 knots
+	{
+		fms::pwflat::file::writer w;
+		auto F = make_curve(100);
+		for (int d = 0; d < 100; ++d) {
+			for (int c = 0; c < 10; ++c) {
+				w.add("CURVE" + std::to_string(c), 20240101 + d, F);
+			}
+		}
+		const char* path = "fms_bench.bin";
+		w.write(path);
+		bench("file::open", "curves", w.size(), 100, [&]() { fms::pwflat::file::reader r(path); sink = double(r.size()); });
+		fms::pwflat::file::reader r(path);
+		int d = 0;
+		bench("file::find+discount", "curves", w.size(), 100'000, [&]() {
+			d = (d + 37) % 100;
+			sink = r.curve(*r.find("CURVE7", 20240101 + d)).discount(17.3);
+		});
+		std::remove(path);
+	}
+
+	// ten years of daily 100 knot curves moving by about 1bp a day, loaded at random dates
+	{
+		size_t days = 2'520, n = 100;
+		std::vector<std::vector<double>> fs;
+		std::vector<double> f(n, 0.03);
+		unsigned x = 1;
+		for (size_t d = 0; d < days; ++d) {
+			for (size_t j = 0; j < n; ++j) {
+				x = x * 1103515245 + 12345;
+				f[j] += 0.0001 * (int((x >> 16) % 201) - 100) / 100;
+			}
+			fs.push_back(f);
+		}
+		std::vector<double> t(n);
+		for (size_t j = 0; j < n; ++j) {
+			t[j] = 30. * (j + 1) / n;
+		}
+		size_t raw = days * (2 * n * sizeof(double) + 2 * sizeof(std::vector<double>));
+		bench("history::raw", "bytes_per_curve", raw / days, 1'000'000, [&]() {
+			x = x * 1103515245 + 12345;
+			sink = fs[x % days][n / 2];
+		});
+		for (double quantum : { 0., 1e-8, 1e-6 }) {
+			fms::pwflat::history h(quantum);
+			for (size_t d = 0; d < days; ++d) {
+				h.add(int32_t(d), fms::pwflat::forward(fms::span<double>(n, t.data()), fms::span<double>(n, fs[d].data())));
+			}
+			h.shrink_to_fit();
+			std::vector<double> buf(h.max_knots());
+			std::string name = quantum ? "history::load/quantum/" + std::to_string(int(-std::log10(quantum) + 0.5)) : "history::load/lossless";
+			bench(name.c_str(), "bytes_per_curve", h.bytes() / days, 100'000, [&]() {
+				x = x * 1103515245 + 12345;
+				sink = h.load(h.find(int32_t(x % days)), buf.data()).discount(15);
+			});
+		}
+	}
+
+	// readers of a published curve with and without a writer publishing at 1 kHz
+	{
+		fms::rcu::cell<curve> c(std::make_unique<const curve>(make_curve(100)));
+		double u = 0;
+		auto next = [&u]() { u = u < 29 ? u + 0.7 : 0.1; return u; };
+		auto read = [&]() {
+			fms::rcu::guard g;
+			sink = c.get(g)->discount(next());
+		};
+		bench("rcu::read", "writers", 0, 1'000'000, read);
+
+		std::atomic<bool> done = false;
+		std::thread writer([&]() {
+			while (!done) {
+				c.publish(std::make_unique<const curve>(make_curve(100)));
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		});
+		bench("rcu::read", "writers", 1, 1'000'000, read);
+		done = true;
+		writer.join();
+	}
+
+	// shared memory store of 100 curves with 100 knots read by many threads
+	// while the publisher rewrites one curve at 1 kHz
+	{
+		fms::pwflat::shared::region m(fms::pwflat::shared::bytes(100, 100));
+		fms::pwflat::shared::publisher w(m.data(), m.size(), 100, 100);
+		auto F = make_curve(100);
+		for (int i = 0; i < 100; ++i) {
+			w.publish("CURVE" + std::to_string(i), F);
+		}
+		fms::pwflat::shared::reader r(m.data(), m.size());
+
+		std::atomic<bool> done = false;
+		std::thread writer([&]() {
+			while (!done) {
+				w.publish("CURVE0", F);
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		});
+		size_t hw = std::max<size_t>(8, std::thread::hardware_concurrency());
+		for (size_t readers = 1; readers <= hw; readers *= 2) {
+			std::vector<double> u(readers, 0);
+			bench_threads("shared::discount", "readers", readers, 1'000'000, [&](size_t k) {
+				u[k] = u[k] < 29 ? u[k] + 0.7 : 0.1;
+				sink = r.discount(size_t(u[k] * 3), u[k]);
+			});
+		}
+		done = true;
+		writer.join();
+	}
+
+	// quote text to published curves, pipelined and on one thread
+	{
+		std::ostringstream os;
+		size_t sets = 1'000;
+		for (size_t k = 0; k < sets; ++k) {
+			double s = 0.0001 * (k % 50);
+			os << "curve C" << k << "\n";
+			for (int i = 1; i <= 4; ++i) {
+				os << "cd " << 0.25 * i << " 0 " << 0.02 + s << "\n";
+			}
+			for (int i = 4; i < 8; ++i) {
+				os << "fra " << 0.25 * i << " 4 " << 0.025 + s << "\n";
+			}
+			for (int i = 3; i <= 30; ++i) {
+				os << "swap " << i << " 2 " << 0.03 + s << "\n";
+			}
+		}
+		std::string text = os.str();
+
+		fms::bootstrap::pipeline pl([](const std::string&, fms::bootstrap::pipeline::forward&& f) { sink = f.value(1); });
+		bench("pipeline::run", "curve_sets", sets, 10, [&]() {
+			std::istringstream is(text);
+			sink = double(pl.run(is));
+		});
+		bench("pipeline::sequential", "curve_sets", sets, 10, [&]() {
+			std::istringstream is(text);
+			std::string line;
+			std::vector<fms::bootstrap::pipeline::instrument> i;
+			std::vector<double> p;
+			const auto solve = [&]() {
+				if (!i.empty()) {
+					p.assign(i.size(), 0.);
+					sink = fms::bootstrap::curve(i.size(), i.data(), p.data()).value(1);
+				}
+				i.clear();
+			};
+			while (std::getline(is, line)) {
+				fms::bootstrap::pipeline::quote q;
+				if (line.compare(0, 6, "curve ") == 0) {
+					solve();
+				}
+				else if (fms::bootstrap::pipeline::parse_quote(line.c_str(), q)) {
+					i.push_back(fms::bootstrap::pipeline::make(q));
+				}
+			}
+			solve();
+		});
+	}
+
+	// Hull-White path steps on one thread, and pathwise pv of a book of swaps
+	{
+		curve F = make_curve(100);
+		F.extrapolate(0.03);
+		std::vector<double> grid;
+		for (int k = 1; k <= 120; ++k) {
+			grid.push_back(k / 12.);
+		}
+		fms::hull_white::simulation s(F, { 0.05, 0.01 }, grid.size(), grid.data());
+		const size_t paths = 4'096;
+		bench("hull_white::step", "steps", grid.size(), 10, [&]() {
+			s.run(paths, 1, [](size_t, size_t count, const double* D) { sink = D[count - 1]; }, 256, 1);
+		}, paths * grid.size());
+
+		std::vector<fms::instrument::interest_rate_swap<>> book;
+		for (int k = 1; k <= 10; ++k) {
+			book.push_back(fms::instrument::interest_rate_swap<>(double(k), 12, 0.03));
+		}
+		auto times = fms::hull_white::times(book.size(), book.data());
+		fms::hull_white::simulation b(F, { 0.05, 0.01 }, times.size(), times.data());
+		bench("hull_white::pv", "trades", book.size(), 10, [&]() {
+			sink = fms::hull_white::pv(b, book.size(), book.data(), paths, 1, 1)[0];
+		}, paths);
+	}
+
+	// pv and extend for each instrument type against a bootstrapped curve
+	auto strip = make_strip(40);
+	std::vector<double> prices(strip.size(), 0.);
+	auto C = fms::bootstrap::curve(strip.size(), strip.data(), prices.data());
+	instrument mix[] = {
+		fms::instrument::flows(fms::instrument::cash_deposit(0.5, 0.02)),
+		fms::instrument::flows(fms::instrument::forward_rate_agreement(1., 0.25, 0.025)),
+		fms::instrument::flows(fms::instrument::interest_rate_swap(10., 2, 0.03)),
+		fms::instrument::flows(fms::instrument::interest_rate_swap(30., 4, 0.03)),
+	};
+	const char* mix_name[] = { "cash_deposit", "forward_rate_agreement", "interest_rate_swap/10y", "interest_rate_swap/30y" };
+	for (size_t k = 0; k < 4; ++k) {
+		std::string name = std::string("bootstrap::pv/") + mix_name[k];
+		bench(name.c_str(), "knots", strip.size(), 100'000, [&]() { sink = fms::bootstrap::pv(C, mix[k]); });
+	}
+	for (size_t k = 0; k < 4; ++k) {
+		// extend the curve up to the start of the last cash flow period
+		size_t m = 0;
+		while (m < strip.size() and *back(strip[m].time()) < *back(mix[k].time()) - 1) {
+			++m;
+		}
+		std::vector<double> p0(m, 0.);
+		auto E = fms::bootstrap::curve(m, strip.data(), p0.data());
+		double t = m ? *back(strip[m - 1].time()) : 0.;
+		std::string name = std::string("bootstrap::extend/") + mix_name[k];
+		bench(name.c_str(), "knots", m, 10'000, [&]() { sink = fms::bootstrap::extend(E, t, 0., mix[k].time(), mix[k].cash()).second; });
+	}
+
+	// full curve bootstraps
+	for (size_t m : { 10, 20, 40 }) {
+		auto s = make_strip(m);
+		std::vector<double> p(m, 0.);
+		bench("bootstrap::curve", "instruments", m, 1'000, [&]() { sink = fms::bootstrap::curve(m, s.data(), p.data()).value(1); });
+	}
+
+	// discount and projection curves from overnight indexed and ibor swaps at annual maturities
+	for (size_t m : { 10, 20, 40 }) {
+		using I = decltype(fms::instrument::overnight_indexed_swap(1., 1, 0.));
+		std::vector<I> a, b;
+		for (size_t k = 1; k <= m; ++k) {
+			a.push_back(fms::instrument::overnight_indexed_swap(double(k), 1, 0.03));
+			b.push_back(fms::instrument::ibor_swap(double(k), 2, 0.035, 4));
+		}
+		std::vector<double> p(m, 0.);
+		bench("bootstrap::curve/ois", "instruments", m, 1'000, [&]() { sink = fms::bootstrap::curve(m, a.data(), p.data()).value(1); });
+		bench("bootstrap::dual_curve", "instruments", m, 1'000, [&]() { sink = fms::bootstrap::dual_curve(m, a.data(), p.data(), b.data(), p.data()).second.value(1); });
+	}
+
+	// burst of quote sets submitted faster than a build, timed from the first submit to the
+	// curve of the last one, so the time should be about one build and not one per submit
+	for (size_t burst : { 1, 10, 100 }) {
+		auto s = make_strip(40);
+		std::vector<double> p(s.size(), 0.);
+		fms::bootstrap::async_curve<instrument> a(1);
+		bench("async_curve::burst", "submits", burst, 100, [&]() {
+			std::future<fms::bootstrap::async_curve<instrument>::curve_ptr> f;
+			for (size_t k = 0; k < burst; ++k) {
+				f = a.submit(s, p);
+			}
+			sink = f.get()->value(1);
+		});
+	}
+
+	// least squares fits with two swaps at each maturity priced off a bootstrapped curve
+	for (size_t m : { 50, 100, 500 }) {
+		auto s = make_strip(m / 2);
+		std::vector<double> p(s.size(), 0.);
+		auto R = fms::bootstrap::curve(s.size(), s.data(), p.data());
+		for (size_t k = 8; k < m / 2; ++k) {
+			s.push_back(fms::instrument::flows(fms::instrument::interest_rate_swap(double(k - 5), 4, 0.025)));
+		}
+		p.clear();
+		for (const auto& i : s) {
+			p.push_back(fms::bootstrap::pv(R, i));
+		}
+		bench("bootstrap::fit", "instruments", s.size(), 10, [&]() { sink = fms::bootstrap::fit(s.size(), s.data(), p.data()).value(1); });
+	}
+
+	// fixed order sum against the left to right loop
+	{
+		std::vector<double> x(1'000'000);
+		for (size_t i = 0; i < x.size(); ++i) {
+			x[i] = 1. / (1 + i);
+		}
+		bench("sum/loop", "terms", x.size(), 10, [&]() {
+			double s = 0;
+			for (double xi : x) {
+				s += xi;
+			}
+			sink = s;
+		}, x.size());
+		bench("reduce::sum", "terms", x.size(), 10, [&]() { sink = fms::reduce::sum(x.size(), x.data()); }, x.size());
+	}
+
+	// portfolio repricing
+	for (size_t b : { 100, 1'000, 10'000 }) {
+		std::vector<fms::instrument::interest_rate_swap<>> book;
+		for (size_t i = 0; i < b; ++i) {
+			book.emplace_back(1. + i % 30, 1 + int(i % 4), 0.01 + 0.0001 * (i % 100));
+		}
+		bench("book::pv", "trades", b, std::max<size_t>(1, 10'000 / b), [&]() {
+			double pv = 0;
+			for (const auto& i : book) {
+				pv += fms::bootstrap::pv(C, i);
+			}
+			sink = pv;
+		});
+		std::vector<double> v(b);
+		bench("book::pv/batch", "trades", b, std::max<size_t>(1, 10'000 / b), [&]() {
+			fms::bootstrap::pv(C, book.size(), book.data(), v.data());
+			sink = v[0];
+		});
+		for (unsigned threads : { 1, 4 }) {
+			bench(threads == 1 ? "book_pv/1" : "book_pv/4", "trades", b, std::max<size_t>(1, 10'000 / b), [&]() {
+				sink = fms::bootstrap::book_pv(C, book.size(), book.data(), v.data(), threads);
+			});
+		}
+		fms::instrument::book columns;
+		for (size_t i = 0; i < b; ++i) {
+			columns.add_interest_rate_swap(1. + i % 30, 1 + int(i % 4), 0.01 + 0.0001 * (i % 100));
+		}
+		bench("book_pv/columns", "trades", b, std::max<size_t>(1, 10'000 / b), [&]() {
+			sink = fms::bootstrap::book_pv(C, columns, v.data(), 1);
+		});
+	}
+
+	printf("%s\n]\n", first ? "[" : "");
+
+	return 0;
+}
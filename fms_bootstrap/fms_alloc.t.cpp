@@ -0,0 +1,152 @@
+// fms_alloc.t.cpp - Test hot paths do not allocate after setup.
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <source_location>
+#include <vector>
+#include "fms_alloc_count.h"
+#include "fms_bootstrap.h"
+#include "fms_instrument.h"
+#include "fms_pwflat_grid.h"
+#include "fms_pwflat_plan.h"
+#include "fms_span.h"
+
+using fms::span;
+using namespace fms::bootstrap;
+using namespace fms::pwflat;
+
+// Call op once to set up, then abort if calling it again allocates.
+// Not an assert so the check is also made with NDEBUG.
+template<class Op>
+inline void no_alloc(Op op, std::source_location l = std::source_location::current())
+{
+	op();
+	size_t a = fms::alloc::count;
+	op();
+	if (size_t b = fms::alloc::count; b != a) {
+		fprintf(stderr, "%s:%u: %zu allocations\n", l.file_name(), static_cast<unsigned>(l.line()), b - a);
+		std::abort();
+	}
+}
+
+static void* volatile escape;
+
+// Every form of operator new is counted.
+int test_alloc_count()
+{
+	struct alignas(64) wide {
+		double x[8];
+	};
+
+	// pointers escape so the compiler can not elide a new and delete pair
+	const auto keep = [](auto* p) {
+		escape = p;
+		return p;
+	};
+
+	size_t a = fms::alloc::count;
+	delete keep(new int);
+	delete[] keep(new int[2]);
+	delete keep(new (std::nothrow) int);
+	delete[] keep(new (std::nothrow) int[2]);
+	delete keep(new wide);
+	delete[] keep(new wide[2]);
+	wide* w = keep(new (std::nothrow) wide);
+	assert(reinterpret_cast<uintptr_t>(w) % 64 == 0);
+	delete w;
+	assert(fms::alloc::count == a + 7);
+
+	return 0;
+}
+int test_alloc_count_ = test_alloc_count();
+
+int test_alloc_pwflat()
+{
+	double t[] = { 1, 2, 3 };
+	double f[] = { .1, .2, .3 };
+	forward F(span<double>(3, t), span<double>(3, f));
+	F.extrapolate(.4);
+
+	volatile double x;
+	no_alloc([&]() { x = F.value(1.5); });
+	no_alloc([&]() { x = F.integral(2.5); });
+	no_alloc([&]() { x = F.discount(3.5); });
+	no_alloc([&]() { x = F.spot(0.5); });
+
+	double u[] = { 0, 0.5, 1.5, 2.5, 3.5 };
+	double v[5];
+	plan p(F.time(), 5, u);
+	std::vector<double> work(p.work_size());
+	no_alloc([&]() { p.discount(F, v, work.data()); });
+	no_alloc([&]() { p.spot(F, v, work.data()); });
+	no_alloc([&]() { grid(F, 0., 0.1, 5, v, v, v); });
+
+	return 0;
+}
+int test_alloc_pwflat_ = test_alloc_pwflat();
+
+int test_alloc_bootstrap()
+{
+	using I = fms::instrument::sequence<span<double>, span<double>>;
+
+	double u0[] = { 0, 0.25 }, c0[] = { -1, 1.01 };
+	double u1[] = { 0.25, 0.5 }, c1[] = { -1, 1.012 };
+	double u2[] = { 0, 0.5, 1, 1.5, 2 }, c2[] = { -1, 0.025, 0.025, 0.025, 1.025 };
+	I i[] = {
+		I(span<double>(2, u0), span<double>(2, c0)),
+		I(span<double>(2, u1), span<double>(2, c1)),
+		I(span<double>(5, u2), span<double>(5, c2)),
+	};
+	double p[] = { 0, 0, 0 };
+	double t[3], f[3];
+	diagnostic d[3];
+
+	volatile double x;
+	no_alloc([&]() { x = curve(3, i, p, t, f, d).value(1); });
+	assert(d[2].time == 2);
+
+	auto F = curve(3, i, p, t, f);
+	no_alloc([&]() { x = pv(F, i[2]); });
+
+	forward G(span<double>(2, t), span<double>(2, f));
+	no_alloc([&]() { x = extend(G, t[1], 0., i[2].time(), i[2].cash()).second; });
+	assert(fabs(x - f[2]) < 1e-10);
+
+	return 0;
+}
+int test_alloc_bootstrap_ = test_alloc_bootstrap();
+
+int test_alloc_instrument()
+{
+	double t[] = { 0.5, 1, 2, 5 };
+	double f[] = { 0.02, 0.025, 0.03, 0.035 };
+	forward F(span<double>(4, t), span<double>(4, f));
+	F.extrapolate(0.035);
+
+	auto cd = fms::instrument::cash_deposit(0.25, 0.02);
+	auto fra = fms::instrument::forward_rate_agreement(0.5, 0.25, 0.025);
+	auto swap = fms::instrument::interest_rate_swap(3., 2, 0.03);
+
+	volatile double x;
+	no_alloc([&]() { x = pv(F, cd); });
+	no_alloc([&]() { x = pv(F, fra); });
+	no_alloc([&]() { x = pv(F, swap); });
+
+	std::vector<fms::instrument::interest_rate_swap<>> s;
+	for (int k = 0; k < 40; ++k) {
+		s.emplace_back(1. + k % 10, 1 + k % 4, 0.01 + 0.001 * k);
+	}
+	std::vector<double> v(s.size());
+	no_alloc([&]() { pv(F, s.size(), s.data(), v.data()); });
+	for (size_t k = 0; k < s.size(); ++k) {
+		assert(fabs(v[k] - pv(F, s[k])) < 1e-13);
+	}
+
+	forward G(span<double>(1, t), span<double>(1, f));
+	no_alloc([&]() { x = extend(G, t[0], 0., fra.time(), fra.cash()).second; });
+
+	return 0;
+}
+int test_alloc_instrument_ = test_alloc_instrument();
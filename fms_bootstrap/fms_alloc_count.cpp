@@ -0,0 +1,127 @@
+// fms_alloc_count.cpp - Replace global operator new to count heap allocations.
+// Every replaceable form is replaced, including nothrow and aligned, so none bypass the count.
+#include <cstdlib>
+#include <new>
+#include "fms_alloc_count.h"
+
+std::atomic<size_t> fms::alloc::count = 0;
+
+namespace {
+
+	void* allocate(size_t n) noexcept
+	{
+		++fms::alloc::count;
+
+		return std::malloc(n ? n : 1);
+	}
+	void* allocate(size_t n, std::align_val_t a) noexcept
+	{
+		++fms::alloc::count;
+		size_t al = static_cast<size_t>(a);
+#ifdef _WIN32
+		return _aligned_malloc(n ? n : 1, al);
+#else
+		// size must be a multiple of the alignment
+		return std::aligned_alloc(al, n ? (n + al - 1) / al * al : al);
+#endif
+	}
+	void deallocate(void* p, std::align_val_t) noexcept
+	{
+#ifdef _WIN32
+		_aligned_free(p);
+#else
+		std::free(p);
+#endif
+	}
+
+}
+
+void* operator new(size_t n)
+{
+	if (void* p = allocate(n)) {
+		return p;
+	}
+
+	throw std::bad_alloc{};
+}
+void* operator new[](size_t n)
+{
+	return operator new(n);
+}
+void* operator new(size_t n, const std::nothrow_t&) noexcept
+{
+	return allocate(n);
+}
+void* operator new[](size_t n, const std::nothrow_t&) noexcept
+{
+	return allocate(n);
+}
+void* operator new(size_t n, std::align_val_t a)
+{
+	if (void* p = allocate(n, a)) {
+		return p;
+	}
+
+	throw std::bad_alloc{};
+}
+void* operator new[](size_t n, std::align_val_t a)
+{
+	return operator new(n, a);
+}
+void* operator new(size_t n, std::align_val_t a, const std::nothrow_t&) noexcept
+{
+	return allocate(n, a);
+}
+void* operator new[](size_t n, std::align_val_t a, const std::nothrow_t&) noexcept
+{
+	return allocate(n, a);
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+void operator delete[](void* p) noexcept
+{
+	std::free(p);
+}
+void operator delete(void* p, size_t) noexcept
+{
+	std::free(p);
+}
+void operator delete[](void* p, size_t) noexcept
+{
+	std::free(p);
+}
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	std::free(p);
+}
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+	std::free(p);
+}
+void operator delete(void* p, std::align_val_t a) noexcept
+{
+	deallocate(p, a);
+}
+void operator delete[](void* p, std::align_val_t a) noexcept
+{
+	deallocate(p, a);
+}
+void operator delete(void* p, size_t, std::align_val_t a) noexcept
+{
+	deallocate(p, a);
+}
+void operator delete[](void* p, size_t, std::align_val_t a) noexcept
+{
+	deallocate(p, a);
+}
+void operator delete(void* p, std::align_val_t a, const std::nothrow_t&) noexcept
+{
+	deallocate(p, a);
+}
+void operator delete[](void* p, std::align_val_t a, const std::nothrow_t&) noexcept
+{
+	deallocate(p, a);
+}
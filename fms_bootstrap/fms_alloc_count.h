@@ -0,0 +1,14 @@
+// fms_alloc_count.h - Count heap allocations in test and benchmark programs.
+// Programs that include this must link fms_alloc_count.cpp, which replaces
+// every form of the global operator new, including nothrow and aligned. The replacement lives in its own translation unit
+// so the compiler never sees it inlined next to a matching delete.
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+namespace fms::alloc {
+
+	// Calls to operator new since the program started.
+	extern std::atomic<size_t> count;
+
+}
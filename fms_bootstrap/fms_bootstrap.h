@@ -2,3 +2,8 @@
 // https://github.com/keithalewis/papers/blob/master/bootstrap.pdf
 #pragma once
 #include "fms_bootstrap_extend.h"
+#include "fms_bootstrap_curve.h"
+#include "fms_bootstrap_cache.h"
+#include "fms_bootstrap_lazy.h"
+#include "fms_bootstrap_fit.h"
+#include "fms_bootstrap_dual.h"
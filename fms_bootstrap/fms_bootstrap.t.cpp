@@ -120,6 +120,85 @@ int test_bootstrap_extend()
 }
 int test_bootstrap_extend_ = test_bootstrap_extend();
 
+int test_bootstrap_extend_nan()
+{
+	// a NaN coupon or price does not extend the curve
+	forward F(list<double>{}, list<double>{});
+	auto swap = fms::instrument::interest_rate_swap(2., 2, std::numeric_limits<double>::quiet_NaN());
+	auto [u, r] = extend(F, 0., 0., swap.time(), swap.cash());
+	assert(std::isnan(u) and std::isnan(r));
+
+	auto swap1 = fms::instrument::interest_rate_swap(2., 2, 0.03);
+	auto [v, s] = extend(F, 0., std::numeric_limits<double>::quiet_NaN(), swap1.time(), swap1.cash());
+	assert(std::isnan(v) and std::isnan(s));
+
+	// no root: pv of positive cash flows can not be negative
+	auto i = fms::instrument::sequence(list({ 1., 2., 3. }), list({ 1., 1., 1. }));
+	int iter;
+	auto [w, q] = extend(F, 0., -1., i.time(), i.cash(), &iter);
+	assert(std::isnan(w) and std::isnan(q));
+	assert(iter <= 100);
+
+	double p = std::numeric_limits<double>::quiet_NaN();
+	try {
+		curve(1, &swap1, &p);
+		assert(false);
+	}
+	catch (const std::runtime_error&) {
+	}
+
+	return 0;
+}
+int test_bootstrap_extend_nan_ = test_bootstrap_extend_nan();
+
+int test_bootstrap_curve()
+{
+	using fms::instrument::sequence;
+	using I = sequence<list<double>, list<double>>;
+
+	I i[] = {
+		fms::instrument::flows(fms::instrument::cash_deposit(0.25, 0.04)),
+		fms::instrument::flows(fms::instrument::forward_rate_agreement(0.25, 0.25, 0.045)),
+		fms::instrument::flows(fms::instrument::forward_rate_agreement(0.5, 0.5, 0.05)),
+		fms::instrument::flows(fms::instrument::interest_rate_swap(2., 2, 0.05)),
+	};
+	double p[] = { 0, 0, 0, 0 };
+	diagnostic d[4];
+
+	auto F = curve(4, i, p, d);
+	for (int k = 0; k < 4; ++k) {
+		assert(fabs(pv(F, i[k]) - p[k]) <= 1e-8);
+		assert(fabs(d[k].residual) <= 1e-8);
+		assert(F.value(d[k].time) == d[k].forward);
+	}
+	assert(d[0].time == 0.25);
+	assert(d[0].iterations == 0);
+	assert(d[3].time == 2);
+	assert(d[3].iterations > 0);
+
+	return 0;
+}
+int test_bootstrap_curve_ = test_bootstrap_curve();
+
+int test_bootstrap_pv_swaps()
+{
+	auto F = forward(list({ 1., 5., 10. }), list({ 0.02, 0.03, 0.035 }));
+	F.extrapolate(0.04);
+
+	std::vector<fms::instrument::interest_rate_swap<>> s;
+	for (int i = 0; i < 40; ++i) {
+		s.emplace_back(0.5 + i * 0.37, 1 + i % 4, 0.01 + 0.001 * i);
+	}
+	std::vector<double> v(s.size());
+	pv(F, s.size(), s.data(), v.data());
+	for (size_t i = 0; i < s.size(); ++i) {
+		assert(fabs(v[i] - pv(F, s[i])) < 1e-14);
+	}
+
+	return 0;
+}
+int test_bootstrap_pv_swaps_ = test_bootstrap_pv_swaps();
+
 int main()
 {
 	return 0;
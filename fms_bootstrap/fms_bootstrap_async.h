@@ -0,0 +1,232 @@
+// fms_bootstrap_async.h - Bootstrap curves in the background, superseding stale quotes.
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../fms_sequence/fms_sequence_list.h"
+#include "fms_bootstrap_curve.h"
+#include "fms_instrument_sequence.h"
+
+/*
+	One worker thread builds the latest submitted quote set. A submit while
+	a build is running replaces any pending set, so at most one set waits.
+	If the running build has solved fewer than a fraction of its segments it
+	is cancelled between segment solves and the newest set starts at once.
+	Otherwise it finishes so a steady stream of quotes can not starve the
+	worker. The time from a submit to a published curve is then at most the
+	unfinished part of one build plus one build.
+
+	A build that completes is published to subscribers and fulfills the
+	future of its own submit and every earlier one, which see the newer curve.
+*/
+
+namespace fms::bootstrap {
+
+	template<class I = fms::instrument::sequence<fms::sequence::list<double>, fms::sequence::list<double>>>
+	class async_curve {
+	public:
+		using forward = pwflat::forward<fms::sequence::list<double>, fms::sequence::list<double>>;
+		using curve_ptr = std::shared_ptr<const forward>;
+		using subscriber = std::function<void(uint64_t id, const curve_ptr& f)>;
+	private:
+		struct request {
+			uint64_t id;
+			std::vector<I> i;
+			std::vector<double> p;
+		};
+
+		double fraction;
+		mutable std::mutex mutex;
+		std::condition_variable cv;
+		std::optional<request> pending;
+		std::vector<std::pair<uint64_t, std::promise<curve_ptr>>> waiting;
+		std::vector<subscriber> subscribers;
+		curve_ptr latest_;
+		uint64_t next_id, latest_id;
+		bool stopping;
+
+		// running build
+		std::atomic<bool> cancel;
+		std::atomic<size_t> progress;
+		size_t segments; // of running build, 0 if none
+
+		std::atomic<uint64_t> built_, cancelled_, superseded_, dropped_;
+		std::thread worker;
+
+		// Fulfill futures of submits up to id.
+		template<class Set>
+		void settle(uint64_t id, Set set)
+		{
+			for (auto w = waiting.begin(); w != waiting.end(); ) {
+				if (w->first <= id) {
+					set(w->second);
+					w = waiting.erase(w);
+				}
+				else {
+					++w;
+				}
+			}
+		}
+
+		void run()
+		{
+			std::vector<double> t, f;
+			while (true) {
+				request r;
+				{
+					std::unique_lock lock(mutex);
+					cv.wait(lock, [this]() { return pending or stopping; });
+					if (stopping) {
+						return;
+					}
+					r = std::move(*pending);
+					pending.reset();
+					cancel = false;
+					progress = 0;
+					segments = r.i.size();
+				}
+
+				size_t n = r.i.size();
+				t.resize(n);
+				f.resize(n);
+				curve_ptr c;
+				std::exception_ptr e;
+				bool done = false;
+				try {
+					curve(n, r.i.data(), r.p.data(), t.data(), f.data(), nullptr, &cancel, &progress);
+					done = progress == n;
+					if (done) {
+						c = std::make_shared<const forward>(fms::sequence::list(n, t.data()), fms::sequence::list(n, f.data()));
+					}
+				}
+				catch (...) {
+					e = std::current_exception();
+					done = true;
+				}
+
+				std::vector<subscriber> subs;
+				{
+					std::lock_guard lock(mutex);
+					segments = 0;
+					if (!done) {
+						++cancelled_;
+						continue;
+					}
+					if (e) {
+						settle(r.id, [&e](std::promise<curve_ptr>& p) { p.set_exception(e); });
+						continue;
+					}
+					latest_ = c;
+					latest_id = r.id;
+					++built_;
+					settle(r.id, [&c](std::promise<curve_ptr>& p) { p.set_value(c); });
+					subs = subscribers;
+				}
+				for (const auto& s : subs) {
+					try {
+						s(r.id, c);
+					}
+					catch (...) {
+						++dropped_; // one subscriber must not stop the worker or the others
+					}
+				}
+			}
+		}
+	public:
+		// Cancel a running build on submit if it has solved less than fraction of its segments.
+		// Use 1 to always cancel and 0 to never cancel.
+		async_curve(double fraction = 0.5)
+			: fraction(fraction), next_id(0), latest_id(0), stopping(false),
+			cancel(false), progress(0), segments(0), built_(0), cancelled_(0), superseded_(0), dropped_(0)
+		{
+			worker = std::thread([this]() { run(); });
+		}
+		async_curve(const async_curve&) = delete;
+		async_curve& operator=(const async_curve&) = delete;
+		~async_curve()
+		{
+			{
+				std::lock_guard lock(mutex);
+				stopping = true;
+				cancel = true;
+				pending.reset();
+			}
+			cv.notify_one();
+			worker.join();
+			// futures still waiting see broken_promise
+		}
+
+		// Build a curve from instruments with increasing maturities and prices p.
+		// The future gets this curve or a newer one if this set is superseded.
+		std::future<curve_ptr> submit(std::vector<I> i, std::vector<double> p)
+		{
+			if (i.size() != p.size()) {
+				throw std::invalid_argument("fms::bootstrap::async_curve::submit: instruments and prices differ in size");
+			}
+
+			std::future<curve_ptr> future;
+			{
+				std::lock_guard lock(mutex);
+				if (pending) {
+					++superseded_;
+				}
+				pending = request{ ++next_id, std::move(i), std::move(p) };
+				waiting.emplace_back(next_id, std::promise<curve_ptr>{});
+				future = waiting.back().second.get_future();
+				if (segments and progress < fraction * segments) {
+					cancel = true;
+				}
+			}
+			cv.notify_one();
+
+			return future;
+		}
+
+		// Call s on the worker thread with each published curve.
+		// Exceptions thrown by s are counted and dropped.
+		void subscribe(subscriber s)
+		{
+			std::lock_guard lock(mutex);
+			subscribers.push_back(std::move(s));
+		}
+
+		// Last published curve and the id of its submit, or null and 0.
+		std::pair<uint64_t, curve_ptr> latest() const
+		{
+			std::lock_guard lock(mutex);
+
+			return { latest_id, latest_ };
+		}
+
+		uint64_t built() const
+		{
+			return built_;
+		}
+		// Builds abandoned for a newer set.
+		uint64_t cancelled() const
+		{
+			return cancelled_;
+		}
+		// Sets replaced before their build started.
+		uint64_t superseded() const
+		{
+			return superseded_;
+		}
+		// Exceptions thrown by subscribers.
+		uint64_t dropped() const
+		{
+			return dropped_;
+		}
+	};
+
+}
@@ -0,0 +1,156 @@
+// fms_bootstrap_async.t.cpp - Test background curve builds with superseding quotes.
+#include <cassert>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "fms_bootstrap_async.h"
+#include "fms_instrument.h"
+
+using namespace fms::bootstrap;
+using fms::sequence::list;
+using instrument = fms::instrument::sequence<list<double>, list<double>>;
+
+// Instrument that takes a while to solve.
+struct slow {
+	instrument i;
+	auto time() const
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		return i.time();
+	}
+	auto cash() const
+	{
+		return i.cash();
+	}
+};
+
+inline std::vector<slow> strip(size_t n, double rate)
+{
+	std::vector<slow> is;
+	for (size_t k = 1; k <= n; ++k) {
+		is.push_back(slow{ fms::instrument::flows(fms::instrument::interest_rate_swap(double(k), 1, rate)) });
+	}
+	return is;
+}
+
+int test_bootstrap_async()
+{
+	std::vector<double> p(20, 0.);
+
+	// curve stops between segments when cancelled and reports progress
+	{
+		std::vector<instrument> i;
+		for (const auto& s : strip(3, 0.03)) {
+			i.push_back(s.i);
+		}
+		std::vector<double> t(3), f(3);
+		std::atomic<bool> cancel(false);
+		std::atomic<size_t> progress(0);
+		auto F = curve(3, i.data(), p.data(), t.data(), f.data(), nullptr, &cancel, &progress);
+		assert(progress == 3);
+		assert(F.discount(2.5) == curve(3, i.data(), p.data()).discount(2.5));
+		cancel = true;
+		progress = 0;
+		auto G = curve(3, i.data(), p.data(), t.data(), f.data(), nullptr, &cancel, &progress);
+		assert(progress == 0);
+		assert(!G.time());
+	}
+
+	// one build gives the same curve as bootstrapping directly
+	{
+		async_curve<slow> a;
+		auto s = strip(3, 0.03);
+		auto c = a.submit(s, std::vector<double>(3, 0.)).get();
+		std::vector<instrument> i = { s[0].i, s[1].i, s[2].i };
+		auto f = curve(i.size(), i.data(), p.data());
+		assert(c->discount(2.5) == f.discount(2.5));
+		assert(a.latest().first == 1 and a.latest().second == c);
+		assert(a.built() == 1);
+	}
+
+	// newer sets cancel a build that has just started and every future gets the newest curve
+	{
+		async_curve<slow> a(1);
+		std::vector<uint64_t> published;
+		a.subscribe([&](uint64_t id, const async_curve<slow>::curve_ptr&) { published.push_back(id); });
+		auto fa = a.submit(strip(20, 0.01), p);
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		auto fb = a.submit(strip(20, 0.02), p);
+		auto fc = a.submit(strip(20, 0.03), p);
+		auto c = fc.get();
+		assert(fa.get() == c and fb.get() == c);
+		assert(a.cancelled() + a.superseded() >= 2);
+		assert(a.built() == 1);
+		assert(fabs(c->value(0.5) - log(1.03)) < 1e-12);
+		assert(published.size() == 1 and published[0] == 3);
+	}
+
+	// never cancelling finishes the running build and skips the set in between
+	{
+		async_curve<slow> a(0);
+		auto fa = a.submit(strip(10, 0.01), std::vector<double>(10, 0.));
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		auto fb = a.submit(strip(10, 0.02), std::vector<double>(10, 0.));
+		auto fc = a.submit(strip(10, 0.03), std::vector<double>(10, 0.));
+		auto c = fc.get();
+		assert(fb.get() == c);
+		assert(fa.get() != c);
+		assert(a.cancelled() == 0 and a.superseded() == 1 and a.built() == 2);
+	}
+
+	// a throwing subscriber does not stop the worker or later subscribers
+	{
+		async_curve<slow> a;
+		std::atomic<size_t> n = 0;
+		a.subscribe([](uint64_t, const async_curve<slow>::curve_ptr&) { throw std::runtime_error("subscriber"); });
+		a.subscribe([&n](uint64_t, const async_curve<slow>::curve_ptr&) { ++n; });
+		a.submit(strip(2, 0.01), std::vector<double>(2, 0.)).get();
+		auto c = a.submit(strip(2, 0.02), std::vector<double>(2, 0.)).get();
+		assert(c and a.built() == 2);
+		// subscribers run in order after the future is set
+		while (n < 2) {
+			std::this_thread::yield();
+		}
+		assert(a.dropped() == 2);
+	}
+
+	// errors reach the future and the previous curve stays published
+	{
+		async_curve<> a;
+		std::vector<instrument> good = { fms::instrument::flows(fms::instrument::cash_deposit(1., 0.02)) };
+		std::vector<instrument> bad = { fms::instrument::flows(fms::instrument::cash_deposit(1., 0.02)), fms::instrument::flows(fms::instrument::cash_deposit(0.5, 0.02)) };
+		auto c = a.submit(good, { 0 }).get();
+		try {
+			a.submit(bad, { 0, 0 }).get();
+			assert(false);
+		}
+		catch (const std::runtime_error&) {
+		}
+		assert(a.latest().second == c);
+		try {
+			a.submit(good, { 0, 0 });
+			assert(false);
+		}
+		catch (const std::invalid_argument&) {
+		}
+	}
+
+	// destroying the builder breaks waiting futures
+	{
+		std::future<async_curve<slow>::curve_ptr> f;
+		{
+			async_curve<slow> a;
+			a.submit(strip(20, 0.01), p);
+			f = a.submit(strip(20, 0.02), p);
+		}
+		try {
+			f.get();
+			assert(false);
+		}
+		catch (const std::future_error&) {
+		}
+	}
+
+	return 0;
+}
+int test_bootstrap_async_ = test_bootstrap_async();
@@ -0,0 +1,148 @@
+// fms_bootstrap_book.h - Present value of a book of instruments on several threads.
+#pragma once
+#include <algorithm>
+#include <map>
+#include <thread>
+#include <vector>
+#include "fms_bootstrap_extend.h"
+#include "fms_instrument_book.h"
+#include "fms_pwflat_plan.h"
+#include "fms_reduce.h"
+
+/*
+	Each instrument is valued on its own so its present value does not depend
+	on which thread computes it. Threads get contiguous ranges of the book and
+	the total is a reduce::sum of the values, so the book pv has the same bits
+	for any number of threads.
+
+	A columnar instrument::book is valued in one pass: discounts at deposit,
+	FRA, and swap maturity times come from one plan over their sorted distinct
+	times and swap coupons use prefix sums of discounts on the shared grid of
+	each frequency as in the batch swap pv.
+*/
+
+namespace fms::bootstrap {
+
+	// Call op(first, count) on ranges covering [0, n) using up to threads threads, 0 for all cores.
+	template<class Op>
+	inline void ranges(size_t n, Op op, unsigned threads = 0)
+	{
+		constexpr size_t grain = 64; // instruments per thread at least
+
+		if (threads == 0) {
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		}
+		threads = static_cast<unsigned>(std::clamp<size_t>(n / grain, 1, threads));
+
+		std::vector<std::thread> ts;
+		size_t first = 0;
+		for (unsigned j = 0; j < threads; ++j) {
+			size_t count = n / threads + (j < n % threads);
+			if (j + 1 < threads) {
+				ts.emplace_back(op, first, count);
+			}
+			else {
+				op(first, count);
+			}
+			first += count;
+		}
+		for (auto& t : ts) {
+			t.join();
+		}
+	}
+
+	// Present values of n instruments in v and their total.
+	template<class T, class F, class I>
+	inline double book_pv(const pwflat::forward<T, F>& f, size_t n, const I* i, double* v, unsigned threads = 0)
+	{
+		ranges(n, [&f, i, v](size_t first, size_t count) {
+			for (size_t k = first; k < first + count; ++k) {
+				v[k] = pv(f, i[k]);
+			}
+		}, threads);
+
+		return reduce::sum(n, v, threads);
+	}
+
+	// Present values of n swaps in v and their total using the batch pv on each range.
+	template<class T, class F, class U, class C, class Q>
+	inline double book_pv(const pwflat::forward<T, F>& f, size_t n, const instrument::interest_rate_swap<U, C, Q>* s, double* v, unsigned threads = 0)
+	{
+		ranges(n, [&f, s, v](size_t first, size_t count) {
+			pv(f, count, s + first, v + first);
+		}, threads);
+
+		return reduce::sum(n, v, threads);
+	}
+
+	// Present values of rows [first, first + count) of book b in v[0], ..., v[count - 1].
+	template<class T, class F>
+	inline void pv(const pwflat::forward<T, F>& f, const instrument::book& b, size_t first, size_t count, double* v)
+	{
+		using kind = instrument::book::kind;
+		const kind* k = b.kinds() + first;
+		const double* s = b.start() + first;
+		const double* t = b.tenor() + first;
+		const double* r = b.rate() + first;
+		const int* q = b.frequency() + first;
+		const size_t* m = b.grid_count() + first;
+
+		// discounts at deposit, FRA, and swap maturity times
+		std::vector<double> u;
+		// prefix sums of discounts on the coupon grid of each swap frequency
+		std::map<int, std::vector<double>> S;
+		for (size_t i = 0; i < count; ++i) {
+			if (k[i] == kind::forward_rate_agreement) {
+				u.push_back(s[i]);
+			}
+			else if (k[i] == kind::interest_rate_swap) {
+				auto& Sq = S[q[i]];
+				Sq.resize(std::max(Sq.size(), m[i]));
+			}
+			u.push_back(s[i] + t[i]);
+		}
+		std::sort(u.begin(), u.end());
+		u.erase(std::unique(u.begin(), u.end()), u.end());
+		std::vector<double> D(u.size());
+		pwflat::plan(f.time(), u.size(), u.data()).discount(f, D.data());
+		for (auto& [q_, Sq] : S) {
+			pwflat::plan p(f.time(), Sq.size(), instrument::schedule::grid(q_, Sq.size()));
+			p.discount(f, Sq.data());
+			for (size_t i = 1; i < Sq.size(); ++i) {
+				Sq[i] += Sq[i - 1];
+			}
+		}
+
+		const auto Du = [&u, &D](double ui) {
+			return D[std::lower_bound(u.begin(), u.end(), ui) - u.begin()];
+		};
+		for (size_t i = 0; i < count; ++i) {
+			switch (k[i]) {
+			case kind::cash_deposit:
+				v[i] = -1 + (1 + r[i] * t[i]) * Du(t[i]);
+				break;
+			case kind::forward_rate_agreement:
+				v[i] = -Du(s[i]) + (1 + r[i] * t[i]) * Du(s[i] + t[i]);
+				break;
+			default:
+				const auto& Sq = S[q[i]];
+				auto c = instrument::interest_rate_swap<>::make_cash(t[i], q[i], r[i]);
+				v[i] = -Sq[0] + c.coupon() * (Sq[m[i] - 1] - Sq[0]) + c.last() * Du(t[i]);
+			}
+		}
+
+		stats::count(stats::pv, count);
+	}
+
+	// Present values of the trades in book b in v and their total.
+	template<class T, class F>
+	inline double book_pv(const pwflat::forward<T, F>& f, const instrument::book& b, double* v, unsigned threads = 0)
+	{
+		ranges(b.size(), [&f, &b, v](size_t first, size_t count) {
+			pv(f, b, first, count, v + first);
+		}, threads);
+
+		return reduce::sum(b.size(), v, threads);
+	}
+
+}
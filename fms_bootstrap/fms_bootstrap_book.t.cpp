@@ -0,0 +1,121 @@
+// fms_bootstrap_book.t.cpp - Test book present values on several threads.
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include "../fms_sequence/fms_sequence_list.h"
+#include "fms_bootstrap.h"
+#include "fms_bootstrap_book.h"
+#include "fms_instrument.h"
+
+using namespace fms;
+using fms::sequence::list;
+
+int test_bootstrap_book()
+{
+	auto f = pwflat::forward(list({ 1., 2., 5., 10. }), list({ 0.02, 0.025, 0.03, 0.035 }), 0.035);
+
+	std::vector<instrument::interest_rate_swap<>> s;
+	std::vector<decltype(instrument::flows(s.front()))> i;
+	for (size_t k = 0; k < 1000; ++k) {
+		s.emplace_back(1. + k % 30, 1 + int(k % 4), 0.01 + 0.0001 * (k % 100));
+		i.push_back(instrument::flows(s.back()));
+	}
+
+	std::vector<double> v(s.size()), w(s.size());
+	double total = bootstrap::book_pv(f, s.size(), s.data(), v.data(), 1);
+	double flows = bootstrap::book_pv(f, i.size(), i.data(), w.data(), 1);
+	double naive = 0;
+	for (size_t k = 0; k < s.size(); ++k) {
+		assert(fabs(v[k] - bootstrap::pv(f, s[k])) < 1e-12);
+		assert(w[k] == bootstrap::pv(f, i[k]));
+		naive += w[k];
+	}
+	assert(fabs(total - naive) < 1e-10);
+	assert(fabs(flows - naive) < 1e-10);
+
+	// same bits on any number of threads
+	for (unsigned threads : { 2, 3, 4, 8, 0 }) {
+		std::vector<double> x(s.size());
+		double t = bootstrap::book_pv(f, s.size(), s.data(), x.data(), threads);
+		assert(std::memcmp(&t, &total, sizeof(double)) == 0);
+		assert(std::memcmp(x.data(), v.data(), x.size() * sizeof(double)) == 0);
+		t = bootstrap::book_pv(f, i.size(), i.data(), x.data(), threads);
+		assert(std::memcmp(&t, &flows, sizeof(double)) == 0);
+	}
+
+	return 0;
+}
+int test_bootstrap_book_ = test_bootstrap_book();
+
+int test_bootstrap_book_columns()
+{
+	auto f = pwflat::forward(list({ 1., 2., 5., 10. }), list({ 0.02, 0.025, 0.03, 0.035 }), 0.035);
+
+	instrument::book b;
+	assert(b.size() == 0);
+	assert(bootstrap::book_pv(f, b, nullptr) == 0);
+
+	for (size_t k = 0; k < 600; ++k) {
+		switch (k % 3) {
+		case 0:
+			b.add_cash_deposit(0.25 * (1 + k % 4), 0.02 + 0.0001 * (k % 50));
+			break;
+		case 1:
+			b.add_forward_rate_agreement(0.5 * (k % 7), 0.25, 0.025);
+			break;
+		default:
+			b.add_interest_rate_swap(1. + k % 30, 1 + int(k % 4), 0.01 + 0.0001 * (k % 100));
+		}
+	}
+	assert(b.size() == 600);
+	assert(b.count(instrument::book::interest_rate_swap) == 200);
+
+	std::vector<double> v(b.size());
+	double total = bootstrap::book_pv(f, b, v.data(), 1);
+	for (size_t k = 0; k < b.size(); ++k) {
+		assert(fabs(v[k] - bootstrap::pv(f, b.flows(k))) < 1e-13);
+	}
+	assert(fabs(total - fms::reduce::sum(v.size(), v.data())) == 0);
+
+	// trades in a range do not depend on the rest of the book
+	std::vector<double> w(100);
+	bootstrap::pv(f, b, 250, 100, w.data());
+	assert(std::memcmp(w.data(), v.data() + 250, w.size() * sizeof(double)) == 0);
+
+	for (unsigned threads : { 2, 3, 8 }) {
+		std::vector<double> x(b.size());
+		double t = bootstrap::book_pv(f, b, x.data(), threads);
+		assert(std::memcmp(&t, &total, sizeof(double)) == 0);
+	}
+
+	try {
+		b.add_interest_rate_swap(5, 0, 0.03);
+		assert(false);
+	}
+	catch (const std::invalid_argument&) {
+	}
+	try {
+		b.add_interest_rate_swap(1e12, 1, 0.03);
+		assert(false);
+	}
+	catch (const std::invalid_argument&) {
+	}
+	try {
+		b.add_interest_rate_swap(5, 366, 0.03);
+		assert(false);
+	}
+	catch (const std::invalid_argument&) {
+	}
+	try {
+		b.add_cash_deposit(-1, 0.03);
+		assert(false);
+	}
+	catch (const std::invalid_argument&) {
+	}
+	assert(b.size() == 600);
+
+	return 0;
+}
+int test_bootstrap_book_columns_ = test_bootstrap_book_columns();
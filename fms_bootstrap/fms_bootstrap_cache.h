@@ -0,0 +1,186 @@
+// fms_bootstrap_cache.h - Cache of bootstrapped curves keyed by instruments and prices.
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "fms_bootstrap_curve.h"
+
+namespace fms::bootstrap {
+
+	// Instrument cash flows and prices flattened into a key.
+	// For each instrument: number of cash flows, times, amounts, and price.
+	template<class I>
+	inline std::vector<double> cache_key(size_t n, const I* i, const double* p)
+	{
+		std::vector<double> key;
+
+		for (size_t k = 0; k < n; ++k) {
+			size_t m = key.size();
+			key.push_back(0);
+			for (auto u = i[k].time(); u; ++u) {
+				key.push_back(*u);
+			}
+			key[m] = static_cast<double>(key.size() - m - 1);
+			for (auto c = i[k].cash(); c; ++c) {
+				key.push_back(*c);
+			}
+			key.push_back(p[k]);
+		}
+
+		return key;
+	}
+
+	// Hash of a cache key.
+	inline size_t cache_hash(const std::vector<double>& key)
+	{
+		size_t h = key.size();
+
+		for (const auto& x : key) {
+			// 0 and -0 compare equal so must hash equal
+			h ^= std::hash<double>{}(x + 0.) + 0x9e3779b9 + (h << 6) + (h >> 2);
+		}
+
+		return h;
+	}
+
+	// Least recently used cache of bootstrapped curves.
+	// A hit returns the previously bootstrapped curve without solving.
+	class cache {
+	public:
+		using forward = pwflat::forward<fms::sequence::list<double>, fms::sequence::list<double>>;
+	private:
+		struct entry {
+			std::vector<double> key;
+			std::shared_ptr<const forward> curve;
+			std::vector<diagnostic> d;
+		};
+		// most recently used at front
+		std::list<entry> lru;
+		std::unordered_multimap<size_t, typename std::list<entry>::iterator> index;
+		size_t capacity_;
+		size_t hits_, misses_;
+		mutable std::mutex mutex;
+
+		// Move entry to front if found. Caller holds the lock.
+		const entry* find(size_t h, const std::vector<double>& key)
+		{
+			auto [b, e] = index.equal_range(h);
+			for (auto j = b; j != e; ++j) {
+				if (j->second->key == key) {
+					lru.splice(lru.begin(), lru, j->second);
+
+					return &*j->second;
+				}
+			}
+
+			return nullptr;
+		}
+		void evict()
+		{
+			while (lru.size() > capacity_) {
+				auto h = cache_hash(lru.back().key);
+				auto [b, e] = index.equal_range(h);
+				for (auto j = b; j != e; ++j) {
+					if (j->second == std::prev(lru.end())) {
+						index.erase(j);
+						break;
+					}
+				}
+				lru.pop_back();
+			}
+		}
+	public:
+		// A capacity of 0 disables caching.
+		cache(size_t capacity = 64)
+			: capacity_(capacity), hits_(0), misses_(0)
+		{ }
+		cache(const cache&) = delete;
+		cache& operator=(const cache&) = delete;
+
+		size_t capacity() const
+		{
+			std::lock_guard lock(mutex);
+
+			return capacity_;
+		}
+		cache& capacity(size_t n)
+		{
+			std::lock_guard lock(mutex);
+
+			capacity_ = n;
+			evict();
+
+			return *this;
+		}
+		size_t size() const
+		{
+			std::lock_guard lock(mutex);
+
+			return lru.size();
+		}
+		size_t hits() const
+		{
+			std::lock_guard lock(mutex);
+
+			return hits_;
+		}
+		size_t misses() const
+		{
+			std::lock_guard lock(mutex);
+
+			return misses_;
+		}
+		cache& clear()
+		{
+			std::lock_guard lock(mutex);
+
+			lru.clear();
+			index.clear();
+
+			return *this;
+		}
+
+		// Cached version of fms::bootstrap::curve.
+		template<class I>
+		std::shared_ptr<const forward> curve(size_t n, const I* i, const double* p, diagnostic* d = nullptr)
+		{
+			auto key = cache_key(n, i, p);
+			auto h = cache_hash(key);
+			{
+				std::lock_guard lock(mutex);
+
+				if (auto e = find(h, key)) {
+					++hits_;
+					if (d) {
+						std::copy(e->d.begin(), e->d.end(), d);
+					}
+
+					return e->curve;
+				}
+				++misses_;
+			}
+
+			// solve outside the lock
+			std::vector<diagnostic> d_(n);
+			auto f = std::make_shared<const forward>(fms::bootstrap::curve(n, i, p, d_.data()));
+			if (d) {
+				std::copy(d_.begin(), d_.end(), d);
+			}
+
+			std::lock_guard lock(mutex);
+			// another thread may have solved the same curve
+			if (capacity_ > 0 and !find(h, key)) {
+				lru.push_front(entry{ std::move(key), f, std::move(d_) });
+				index.emplace(h, lru.begin());
+				evict();
+			}
+
+			return f;
+		}
+	};
+
+}
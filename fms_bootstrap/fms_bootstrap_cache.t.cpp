@@ -0,0 +1,54 @@
+// fms_bootstrap_cache.t.cpp - Test cache of bootstrapped curves.
+#include <cassert>
+#include "fms_bootstrap.h"
+#include "fms_instrument.h"
+
+using namespace fms::bootstrap;
+using fms::sequence::list;
+
+int test_bootstrap_cache()
+{
+	using I = fms::instrument::sequence<list<double>, list<double>>;
+
+	I i[] = {
+		fms::instrument::flows(fms::instrument::cash_deposit(0.25, 0.04)),
+		fms::instrument::flows(fms::instrument::forward_rate_agreement(0.25, 0.25, 0.045)),
+		fms::instrument::flows(fms::instrument::interest_rate_swap(1., 2, 0.05)),
+	};
+	double p[] = { 0, 0, 0 };
+	diagnostic d[3];
+
+	cache c(2);
+	auto f0 = c.curve(3, i, p, d);
+	assert(c.size() == 1);
+	assert(c.misses() == 1 and c.hits() == 0);
+
+	// same instruments and prices
+	auto f1 = c.curve(3, i, p, d);
+	assert(f1 == f0);
+	assert(c.hits() == 1);
+	assert(d[2].time == 1);
+
+	// different prices
+	double q[] = { 0, 0, 0.001 };
+	auto f2 = c.curve(3, i, q);
+	assert(f2 != f0);
+	assert(c.size() == 2);
+
+	// fewer instruments, evicts least recently used
+	auto f3 = c.curve(2, i, p);
+	assert(c.size() == 2);
+	assert(f3->value(0.5) == f0->value(0.5));
+	c.curve(3, i, q);
+	assert(c.hits() == 2);
+	c.curve(3, i, p);
+	assert(c.misses() == 4);
+
+	c.capacity(0);
+	assert(c.size() == 0);
+	auto f4 = c.curve(3, i, p);
+	assert(f4 != c.curve(3, i, p));
+
+	return 0;
+}
+int test_bootstrap_cache_ = test_bootstrap_cache();
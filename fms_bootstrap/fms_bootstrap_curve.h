@@ -0,0 +1,75 @@
+// fms_bootstrap_curve.h - Bootstrap a piecewise flat forward curve from instruments.
+#pragma once
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+#include "../fms_sequence/fms_sequence_list.h"
+#include "fms_span.h"
+#include "fms_bootstrap_extend.h"
+
+namespace fms::bootstrap {
+
+	// Solver diagnostics for one segment of a bootstrapped curve.
+	struct diagnostic {
+		double time;     // knot time
+		double forward;  // forward rate up to time
+		int iterations;  // secant iterations, 0 for closed form solutions
+		double residual; // price minus present value on the extended curve
+	};
+
+	// Bootstrap a curve from n instruments with increasing maturities and prices p
+	// into caller provided arrays t and f of knot times and forwards.
+	// Each instrument must have a cash flow past the last cash flow of the previous one.
+	// If d is not null it must point to n diagnostics to be filled in.
+	// If cancel is not null and gets set, stop between segments and return the knots solved so far.
+	// Only complete curves are timed.
+	// If progress is not null it is set to the number of segments solved.
+	// The returned curve refers to t and f. It does not allocate if the instruments do not.
+	template<class I>
+	inline auto curve(size_t n, const I* i, const double* p, double* t, double* f, diagnostic* d = nullptr,
+		const std::atomic<bool>* cancel = nullptr, std::atomic<size_t>* progress = nullptr)
+	{
+		stats::scope timer(stats::curve_ns);
+
+		double _t = 0; // end of curve
+
+		for (size_t k = 0; k < n; ++k) {
+			if (cancel and cancel->load(std::memory_order_relaxed)) {
+				timer.discard();
+
+				return pwflat::forward(span<double>(k, t), span<double>(k, f));
+			}
+			pwflat::forward F(span<double>(k, t), span<double>(k, f));
+			int iter;
+			auto [u, r] = extend(F, _t, p[k], i[k].time(), i[k].cash(), &iter);
+			if (std::isnan(u) or std::isnan(r)) {
+				throw std::runtime_error("fms::bootstrap::curve: instrument does not extend the curve");
+			}
+			if (d) {
+				d[k] = diagnostic{ u, r, iter, p[k] - pv(F, i[k]) };
+			}
+
+			t[k] = u;
+			f[k] = r;
+			_t = u;
+			if (progress) {
+				progress->store(k + 1, std::memory_order_relaxed);
+			}
+		}
+
+		return pwflat::forward(span<double>(n, t), span<double>(n, f));
+	}
+
+	// Bootstrap a curve that owns its knots.
+	template<class I>
+	inline auto curve(size_t n, const I* i, const double* p, diagnostic* d = nullptr)
+	{
+		std::vector<double> t(n), f(n);
+
+		curve(n, i, p, t.data(), f.data(), d);
+
+		return pwflat::forward(fms::sequence::list(n, t.data()), fms::sequence::list(n, f.data()));
+	}
+
+}
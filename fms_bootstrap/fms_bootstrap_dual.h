@@ -0,0 +1,241 @@
+// fms_bootstrap_dual.h - Joint bootstrap of discount and projection curves.
+// Fixed cash flows and float payments are discounted on D and float
+// payments are projected on P. Both curves have the same knots.
+#pragma once
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "../fms_sequence/fms_sequence_list.h"
+#include "fms_span.h"
+#include "fms_bootstrap_extend.h"
+#include "fms_instrument_float.h"
+
+namespace fms::bootstrap {
+
+	// Present value of an instrument with a float leg given discount curve D and projection curve P.
+	template<class T, class F, class T_, class F_, class U, class C, class V>
+	inline double pv(const pwflat::forward<T, F>& D, const pwflat::forward<T_, F_>& P, const instrument::fixed_float<U, C, V>& i)
+	{
+		double s = pv(D, static_cast<const instrument::sequence<U, C>&>(i));
+
+		auto v = i.leg().time();
+		if (v) {
+			double P0 = P.discount(*v);
+			for (++v; v; ++v) {
+				double P1 = P.discount(*v);
+				s += i.leg().notional() * D.discount(*v) * (P0 / P1 - 1);
+				P0 = P1;
+			}
+		}
+
+		return s;
+	}
+
+	// Cash flows of an instrument with a float leg split at the end t of both curves.
+	// Flows before t are summed once and flows after t are kept relative to t so the
+	// value and gradient in the forwards (fD, fP) past t cost one pass over them.
+	class dual_segment {
+		struct period {
+			double n;  // notional
+			double dv; // payment time minus t
+			double A;  // P(v_{k-1})/P(t) if the period starts before t, else 1
+			double b;  // part of the period after t
+		};
+		double pv_, Dt;
+		std::vector<std::pair<double, double>> fixed; // (c, u - t)
+		std::vector<period> floating;
+		double u_; // last cash flow time
+	public:
+		dual_segment()
+			: pv_(0), Dt(1), u_(0)
+		{ }
+
+		template<class T, class F, class T_, class F_, class U, class C, class V>
+		dual_segment& reset(const pwflat::forward<T, F>& D, const pwflat::forward<T_, F_>& P, double t, const instrument::fixed_float<U, C, V>& i)
+		{
+			fixed.clear();
+			floating.clear();
+			pv_ = 0;
+			u_ = 0;
+
+			pwflat::integral_walk ID(D);
+			Dt = exp(-D.integral(t));
+			auto u = i.time();
+			auto c = i.cash();
+			for (; u and c; ++u, ++c) {
+				if (*u < t) {
+					pv_ += *c * exp(-ID(*u));
+				}
+				else {
+					fixed.emplace_back(*c, *u - t);
+				}
+				u_ = std::max(u_, *u);
+			}
+
+			pwflat::integral_walk IP(P), IDv(D);
+			const double n = i.leg().notional();
+			const double It = P.integral(t);
+			auto v = i.leg().time();
+			if (v) {
+				double v0 = *v;
+				double I0 = v0 < t ? IP(v0) : It;
+				for (++v; v; ++v) {
+					double v1 = *v;
+					if (v1 < t) {
+						double I1 = IP(v1);
+						pv_ += n * exp(-IDv(v1)) * (exp(I1 - I0) - 1);
+						I0 = I1;
+					}
+					else {
+						floating.push_back(period{ n, v1 - t, v0 < t ? exp(It - I0) : 1, v1 - std::max(v0, t) });
+						I0 = It;
+					}
+					v0 = v1;
+					u_ = std::max(u_, v1);
+				}
+			}
+
+			return *this;
+		}
+
+		// Number of cash flows past t.
+		size_t size() const
+		{
+			return fixed.size() + floating.size();
+		}
+		double maturity() const
+		{
+			return u_;
+		}
+
+		// Present value and its derivatives with respect to fD and fP.
+		std::tuple<double, double, double> operator()(double fD, double fP) const
+		{
+			double v = 0, dD = 0, dP = 0;
+
+			for (const auto& [c, du] : fixed) {
+				double x = c * exp(-fD * du);
+				v += x;
+				dD -= du * x;
+			}
+			for (const auto& k : floating) {
+				double e = k.n * exp(-fD * k.dv);
+				double a = k.A * exp(fP * k.b);
+				v += e * (a - 1);
+				dD -= k.dv * e * (a - 1);
+				dP += e * a * k.b;
+			}
+
+			return { pv_ + Dt * v, Dt * dD, Dt * dP };
+		}
+	};
+
+	// Extend discount curve D and projection curve P past t with flat forwards (fD, fP)
+	// so instruments a and b have prices pa and pb. Each step is a 2x2 Newton solve.
+	// The curves are left extrapolated at the solution. Returns the new knot time
+	// and forwards, or NaNs if the instruments do not determine both forwards.
+	// If n is not null it is set to the number of Newton iterations.
+	template<class T, class F, class T_, class F_, class I, class J>
+	inline std::tuple<double, double, double> extend(pwflat::forward<T, F>& D, pwflat::forward<T_, F_>& P, double t,
+		double pa, const I& a, double pb, const J& b, int* n = nullptr)
+	{
+		constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+
+		stats::scope timer(stats::extend_ns);
+
+		// initial guess is the last forward on each curve
+		double fD = 0.01, fP = 0.01;
+		for (auto f = D.rate(); f; ++f) {
+			fD = *f;
+		}
+		for (auto f = P.rate(); f; ++f) {
+			fP = *f;
+		}
+		D.extrapolate();
+		P.extrapolate();
+
+		// reused so no allocation after warm up
+		thread_local dual_segment sa, sb;
+		sa.reset(D, P, t, a);
+		sb.reset(D, P, t, b);
+		if (sa.size() == 0 or sb.size() == 0) {
+			return { NaN, NaN, NaN };
+		}
+
+		int iter = 0;
+		double ra, rb;
+		while (true) {
+			auto [va, aD, aP] = sa(fD, fP);
+			auto [vb, bD, bP] = sb(fD, fP);
+			ra = va - pa;
+			rb = vb - pb;
+			if (std::max(fabs(ra), fabs(rb)) < 1e-12 or iter == 50) {
+				break;
+			}
+			double det = aD * bP - aP * bD;
+			if (det == 0 or !std::isfinite(det)) {
+				return { NaN, NaN, NaN };
+			}
+			fD -= (bP * ra - aP * rb) / det;
+			fP -= (aD * rb - bD * ra) / det;
+			++iter;
+		}
+		if (std::max(fabs(ra), fabs(rb)) >= 1e-8) {
+			return { NaN, NaN, NaN };
+		}
+
+		D.extrapolate(fD);
+		P.extrapolate(fP);
+		if (n) {
+			*n = iter;
+		}
+		stats::segment(iter, std::max(fabs(ra), fabs(rb)));
+
+		return { std::max(sa.maturity(), sb.maturity()), fD, fP };
+	}
+
+	// Bootstrap discount and projection curves from n pairs of instruments with prices.
+	// Pair k determines the forwards of both curves up to its last cash flow time, so
+	// for example a overnight indexed swap and an ibor swap with the same maturity.
+	// Knot times and forwards are written to caller provided arrays t, fD and fP and
+	// the returned curves refer to them.
+	template<class I, class J>
+	inline auto dual_curve(size_t n, const I* a, const double* pa, const J* b, const double* pb, double* t, double* fD, double* fP)
+	{
+		stats::scope timer(stats::curve_ns);
+
+		double _t = 0;
+
+		for (size_t k = 0; k < n; ++k) {
+			pwflat::forward D(span<double>(k, t), span<double>(k, fD));
+			pwflat::forward P(span<double>(k, t), span<double>(k, fP));
+			auto [u, rD, rP] = extend(D, P, _t, pa[k], a[k], pb[k], b[k]);
+			if (std::isnan(u) or !(u > _t)) {
+				throw std::runtime_error("fms::bootstrap::dual_curve: instruments do not extend the curves");
+			}
+
+			t[k] = u;
+			fD[k] = rD;
+			fP[k] = rP;
+			_t = u;
+		}
+
+		return std::pair(pwflat::forward(span<double>(n, t), span<double>(n, fD)), pwflat::forward(span<double>(n, t), span<double>(n, fP)));
+	}
+
+	// Bootstrap discount and projection curves that own their knots.
+	template<class I, class J>
+	inline auto dual_curve(size_t n, const I* a, const double* pa, const J* b, const double* pb)
+	{
+		std::vector<double> t(n), fD(n), fP(n);
+
+		dual_curve(n, a, pa, b, pb, t.data(), fD.data(), fP.data());
+
+		return std::pair(pwflat::forward(fms::sequence::list(n, t.data()), fms::sequence::list(n, fD.data())),
+			pwflat::forward(fms::sequence::list(n, t.data()), fms::sequence::list(n, fP.data())));
+	}
+
+}
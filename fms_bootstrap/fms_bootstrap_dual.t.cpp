@@ -0,0 +1,71 @@
+// fms_bootstrap_dual.t.cpp - Test joint bootstrap of discount and projection curves.
+#include <cassert>
+#include <vector>
+#include "fms_bootstrap.h"
+#include "fms_instrument.h"
+
+using namespace fms::bootstrap;
+using namespace fms::instrument;
+using fms::sequence::list;
+
+int test_bootstrap_dual_pv()
+{
+	auto D = fms::pwflat::forward(list({ 1., 3., 5. }), list({ 0.02, 0.025, 0.03 }));
+	auto P = fms::pwflat::forward(list({ 2., 4. }), list({ 0.025, 0.03 }));
+	P.extrapolate(0.035);
+
+	// float leg projected on the discount curve telescopes
+	for (double u : { 1., 2., 5. }) {
+		auto s = ibor_swap(u, 2, 0.03, 4);
+		auto t = interest_rate_swap(u, 2, 0.03);
+		assert(fabs(pv(D, D, s) - pv(D, t)) < 1e-14);
+
+		auto o = overnight_indexed_swap(u, 2, 0.03);
+		assert(pv(D, P, o) == pv(D, t));
+	}
+
+	// float payments use projected forwards
+	auto s = ibor_swap(1., 1, 0., 2);
+	double f = -D.discount(0.5) * (1 / P.discount(0.5) - 1) - D.discount(1) * (P.discount(0.5) / P.discount(1) - 1);
+	assert(fabs(pv(D, P, s) - f) < 1e-15);
+
+	return 0;
+}
+int test_bootstrap_dual_pv_ = test_bootstrap_dual_pv();
+
+int test_bootstrap_dual_curve()
+{
+	auto D = fms::pwflat::forward(list({ 1., 2., 3., 5., 7., 10. }), list({ 0.02, 0.022, 0.025, 0.027, 0.03, 0.031 }));
+	auto P = fms::pwflat::forward(list({ 1., 2., 3., 5., 7., 10. }), list({ 0.024, 0.027, 0.029, 0.032, 0.033, 0.035 }));
+
+	using I = decltype(overnight_indexed_swap(1., 1, 0.));
+	std::vector<I> a, b;
+	std::vector<double> pa, pb;
+	for (double u : { 1., 2., 3., 5., 7., 10. }) {
+		a.push_back(overnight_indexed_swap(u, 1, 0.025));
+		b.push_back(ibor_swap(u, 2, 0.03, 4));
+		pa.push_back(pv(D, P, a.back()));
+		pb.push_back(pv(D, P, b.back()));
+	}
+
+	auto [D_, P_] = dual_curve(a.size(), a.data(), pa.data(), b.data(), pb.data());
+	for (double u : { 0.5, 1., 1.5, 2.5, 4., 6., 8., 10. }) {
+		assert(fabs(D_.value(u) - D.value(u)) < 1e-10);
+		assert(fabs(P_.value(u) - P.value(u)) < 1e-10);
+	}
+	for (size_t k = 0; k < a.size(); ++k) {
+		assert(fabs(pv(D_, P_, a[k]) - pa[k]) < 1e-12);
+		assert(fabs(pv(D_, P_, b[k]) - pb[k]) < 1e-12);
+	}
+
+	// two instruments that only depend on the discount curve
+	try {
+		dual_curve(1, a.data(), pa.data(), a.data(), pa.data());
+		assert(false);
+	}
+	catch (const std::runtime_error&) {
+	}
+
+	return 0;
+}
+int test_bootstrap_dual_curve_ = test_bootstrap_dual_curve();
@@ -1,23 +1,79 @@
 // fms_bootstrap_extend.h - Bootstrap extension to piecewise constant forward curves.
 // https://github.com/keithalewis/papers/blob/master/bootstrap.pdf
 #pragma once
+#include <algorithm>
+#include <cmath>
 #include <limits>
 #include <utility>
+#include <vector>
 #include "../fms_sequence/fms_sequence.h"
 #include "fms_pwflat.h"
 #include "fms_instrument_sequence.h"
+#include "fms_instrument_swap.h"
+#include "fms_stats.h"
 
 namespace fms::bootstrap {
 
-	// Present value of instrument given a forward curve.
-	template<class U, class C>
-	inline auto pv(const pwflat::forward<U, C>& f, const instrument::sequence<U, C>& i)
+	// Present value of instrument, or anything with time() and cash(), given a forward curve.
+	template<class T, class F, class I>
+	inline auto pv(const pwflat::forward<T, F>& f, const I& i)
 	{
 		const auto D = [&f](auto t) { return f.discount(t); };
 
+		stats::count(stats::pv);
+
 		return sum(i.cash(), sequence::apply(D, i.time()));
 	}
 
+	// Present values of n swaps. Discounts at the times of each shared coupon grid
+	// are computed once and summed so each swap costs one more discount.
+	// Scratch space is reused so there is no allocation after warm up.
+	template<class T, class F, class U, class C, class Q>
+	inline void pv(const pwflat::forward<T, F>& f, size_t n, const instrument::interest_rate_swap<U, C, Q>* s, double* v)
+	{
+		// prefix sums of discounts at grid times, one entry per grid in use
+		thread_local std::vector<std::pair<const double*, std::vector<double>>> S;
+		size_t m = 0;
+		const auto find = [&m](const double* g) -> std::vector<double>& {
+			for (size_t j = 0; j < m; ++j) {
+				if (S[j].first == g) {
+					return S[j].second;
+				}
+			}
+			if (m == S.size()) {
+				S.emplace_back();
+			}
+			S[m].first = g;
+			S[m].second.clear();
+
+			return S[m++].second;
+		};
+
+		for (size_t k = 0; k < n; ++k) {
+			auto& Sk = find(s[k].time().grid());
+			Sk.resize(std::max(Sk.size(), s[k].time().count()));
+		}
+		for (size_t j = 0; j < m; ++j) {
+			const double* g = S[j].first;
+			auto& Sg = S[j].second;
+			pwflat::integral_walk I(f);
+			for (size_t i = 0; i < Sg.size(); ++i) {
+				Sg[i] = exp(-I(g[i])) + (i ? Sg[i - 1] : 0);
+			}
+		}
+
+		for (size_t k = 0; k < n; ++k) {
+			const auto& u = s[k].time();
+			const auto& c = s[k].cash();
+			const auto& Sk = find(u.grid());
+			auto mk = u.count();
+
+			v[k] = -Sk[0] + c.coupon() * (Sk[mk - 1] - Sk[0]) + c.last() * f.discount(u.maturity());
+		}
+
+		stats::count(stats::pv, n);
+	}
+
 	//template<class X>
 	//constexpr X NaN = std::numeric_limits<X>::quiet_NaN();
 
@@ -39,66 +95,109 @@ namespace fms::bootstrap {
 
 	// Extrapolate forward curve for given a price and instrument.
 	// p = sum_{u_j <= t} c_j D_j + sum_{u_k > t} c_k D(t) exp(-f (u_k - t)) = pv_ + _pv
-	template</*class P,*/ class T, class C>
+	// The curve is left extrapolated at the solution. If n is not null it is set
+	// to the number of secant iterations, 0 for the closed form solutions.
+	// Returns NaNs if the price is not finite or the secant does not converge.
+	template</*class P,*/ class T, class F, class U, class C>
 //!!	inline std::pair<T, C> extend(pwflat::forward<T,C>& f, const T& t, const P& p, T u, C c)
-	inline std::pair<double, double> extend(pwflat::forward<T,C>& f, const double& t, const double& p, T u, C c)
+	inline std::pair<double, double> extend(pwflat::forward<T,F>& f, const double& t, const double& p, U u, C c, int* n = nullptr)
 	{
-		typedef double P;
-        using fms::sequence::apply;
-        using fms::sequence::filter;
-        using fms::sequence::sum;
+		stats::scope timer(stats::extend_ns);
 
 		// set extrapolated value to NaN
 		f.extrapolate();
 
-		// discount function
-		auto D = [&f](const double& x) { return f.discount(x); };
-
-		// Cash flow times up to t.
-		auto u_ = filter([t](auto _u) { return _u < t; }, u);	
-		auto D_ = apply(D, u_);
-		auto pv_ = sum(c * D_);
-
-		auto n_ = length(u_);
-		auto _u = skip(n_, u);
-		auto _c = skip(n_, c);
-		auto _n = length(_u); // remaining cash flows 
+		// Integral of curve at increasing times in one walk over the knots.
+		pwflat::integral_walk I(f);
+
+		// One pass over cash flows: pv of flows before t and
+		// (c_k, u_k - t) of the remaining flows in a contiguous buffer.
+		thread_local std::vector<std::pair<double, double>> _cu; // reused so no allocation after warm up
+		_cu.clear();
+		double pv_ = 0;
+		double u_last = 0;
+		while (u and c) {
+			if (*u < t) {
+				pv_ += *c * exp(-I(*u));
+			}
+			else {
+				_cu.emplace_back(*c, *u - t);
+				u_last = *u;
+			}
+			++u;
+			++c;
+		}
+		const auto _n = _cu.size(); // remaining cash flows
 
 		if (_n == 0) {
 			return std::pair(std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::quiet_NaN());
 		}
+		if (n) {
+			*n = 0;
+		}
+
+		const double Dt = exp(-I(t));
+
+		// closed form residuals are not computed
 		if (_n == 1) {
-			return std::pair(*_u, extend1(p, pv_, *_c, D(t), *_u - t));
+			auto f_ = extend1(p, pv_, _cu[0].first, Dt, _cu[0].second);
+			f.extrapolate(f_);
+			stats::segment(0, 0);
+
+			return std::pair(u_last, f_);
 		}
 		if (_n == 2 and (p - pv_) + 1 == 1) {
-			auto u0 = *_u;
-			auto u1 = *++_u;
-			auto c0 = *_c;
-			auto c1 = *++_c;
+			auto f_ = extend2(_cu[0].first, _cu[0].second, _cu[1].first, _cu[1].second);
+			f.extrapolate(f_);
+			stats::segment(0, 0);
 
-			return std::pair(u1, extend2(c0, u0, c1, u1));
+			return std::pair(u_last, f_);
 		}
 
-		double f0 = 0.01;
-		const instrument::sequence i(_c, _u);
-		f.extrapolate(f0);
-		auto _pv0 = pv(f, i);
+		// _pv(f) = D(t) sum_k c_k exp(-f (u_k - t)) without touching the curve
+		const auto _pv = [Dt](double f_) {
+			double s = 0;
+			for (const auto& [c_, du] : _cu) {
+				s += c_ * exp(-f_ * du);
+			}
+
+			return Dt * s;
+		};
 
+		double f0 = 0.01;
+		auto _pv0 = _pv(f0);
 		auto f1 = 0.02; // initial guesses for secant
-		f.extrapolate(f1);
-		auto _pv1 = pv(f, i);
-		
-		// Find root using secant method.
-		while (fabs(-p + pv_ + _pv1) >= 1e-8) {
-			double f2 = (f0 * _pv1 - f1*_pv0) / (_pv1 - _pv0);
+		auto _pv1 = _pv(f1);
+
+		// Find root of _pv(f) = p - pv_ using secant method. Iterate until the residual
+		// is a few ulps of the price or the secant stops moving, then accept it if it is
+		// below tolerance. A non-finite residual or no root returns NaN.
+		constexpr int max_iter = 100;
+		constexpr double tolerance = 1e-8;
+		const auto _p = p - pv_;
+		const double ulps = 4 * std::numeric_limits<double>::epsilon() * std::max(1., fabs(_p));
+		int iter = 0;
+		while (std::isfinite(_pv1) and fabs(_pv1 - _p) > ulps and _pv1 != _pv0 and iter < max_iter) {
+			double f2 = (f0 * (_pv1 - _p) - f1 * (_pv0 - _p)) / (_pv1 - _pv0);
+			if (f2 == f1) {
+				break;
+			}
 			_pv0 = _pv1;
-			f.extrapolate(f2);
-			_pv1 = pv(f, i);
+			_pv1 = _pv(f2);
 			f0 = f1;
 			f1 = f2;
+			++iter;
+		}
+		if (n) {
+			*n = iter;
 		}
+		if (!(fabs(_pv1 - _p) <= tolerance)) {
+			return std::pair(std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::quiet_NaN());
+		}
+		f.extrapolate(f1);
+		stats::segment(iter, _pv1 - _p);
 
-		return std::pair<double,double>(*back(_u), f1);
+		return std::pair<double,double>(u_last, f1);
 	}
 
 }
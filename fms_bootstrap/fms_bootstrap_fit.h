@@ -0,0 +1,278 @@
+// fms_bootstrap_fit.h - Fit all knots of a piecewise flat forward curve at once.
+// Handles redundant or overlapping quotes that sequential bootstrapping can not.
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include "fms_bootstrap_extend.h"
+#include "fms_stats.h"
+
+namespace fms::bootstrap {
+
+	// Result of a least squares fit.
+	struct fit_result {
+		int iterations;  // Levenberg-Marquardt steps accepted
+		double residual; // maximum absolute price minus present value
+	};
+
+	// Distinct last cash flow times of n instruments in increasing order.
+	template<class I>
+	inline std::vector<double> fit_knots(size_t n, const I* i)
+	{
+		std::vector<double> t;
+
+		for (size_t k = 0; k < n; ++k) {
+			double u = 0;
+			for (auto u_ = i[k].time(); u_; ++u_) {
+				u = *u_;
+			}
+			if (u > 0) {
+				t.push_back(u);
+			}
+		}
+		std::sort(t.begin(), t.end());
+		t.erase(std::unique(t.begin(), t.end()), t.end());
+
+		return t;
+	}
+
+	// Least squares fit of forwards f on m knots t to n instruments with prices p.
+	// On entry f is the initial guess and on exit the fitted forwards.
+	// The unknowns are y_l = int_0^{t_l} f so log D is linear between knots and each
+	// cash flow depends on at most two adjacent unknowns. The Jacobian has one nonzero
+	// per instrument and segment touched, and Gauss-Newton steps are solved by
+	// preconditioned conjugate gradients using only products with the Jacobian.
+	// Each product is linear in the number nnz of Jacobian nonzeros but a step can take
+	// up to 2m conjugate gradient iterations, so a step costs O(m nnz), not O(nnz).
+	template<class I>
+	inline fit_result fit(size_t m, const double* t, double* f, size_t n, const I* i, const double* p,
+		double tolerance = 1e-10, int max_iterations = 100)
+	{
+		stats::scope timer(stats::fit_ns);
+
+		if (m == 0 or n == 0) {
+			throw std::runtime_error("fms::bootstrap::fit: no knots or instruments");
+		}
+		for (size_t l = 0; l < m; ++l) {
+			if (t[l] <= (l ? t[l - 1] : 0)) {
+				throw std::runtime_error("fms::bootstrap::fit: knots must be positive and increasing");
+			}
+		}
+
+		// cash flows with segment and interpolation weight
+		// log D(u) = -((1 - w) y_{s-1} + w y_s), y_{-1} = 0
+		struct flow {
+			double c, w;
+			size_t k, s;
+			size_t a, b; // Jacobian entries for columns s - 1 and s
+		};
+		std::vector<flow> cf;
+		// compressed sparse rows of the Jacobian d pv_k/d y_l built in the same pass
+		std::vector<size_t> row(n + 1, 0), col;
+		const size_t none = std::numeric_limits<size_t>::max();
+		// columns of a row are increasing so an entry is one of the last two or new
+		const auto entry = [&](size_t k, size_t l) {
+			size_t e = col.size();
+			if (e > row[k] and col[e - 1] == l) {
+				return e - 1;
+			}
+			if (e > row[k] + 1 and col[e - 2] == l) {
+				return e - 2;
+			}
+			if (e > row[k] and col[e - 1] > l) {
+				throw std::runtime_error("fms::bootstrap::fit: cash flow times must be increasing");
+			}
+			col.push_back(l);
+
+			return e;
+		};
+		for (size_t k = 0; k < n; ++k) {
+			row[k] = col.size();
+			size_t s = 0;
+			auto u = i[k].time();
+			auto c = i[k].cash();
+			for (; u and c; ++u, ++c) {
+				while (s + 1 < m and t[s] < *u) {
+					++s; // extrapolate last forward
+				}
+				double t_ = s ? t[s - 1] : 0;
+				size_t a = s ? entry(k, s - 1) : none;
+				size_t b = entry(k, s);
+				cf.push_back(flow{ *c, (*u - t_) / (t[s] - t_), k, s, a, b });
+			}
+		}
+		row[n] = col.size();
+		for (auto& x : cf) {
+			if (x.a == none) {
+				x.a = col.size(); // y_{-1} is not an unknown
+			}
+		}
+		std::vector<double> J(col.size() + 1); // last entry absorbs y_{-1}
+
+		// residuals pv - p and, if jacobian, the Jacobian at y
+		std::vector<double> r(n);
+		const auto eval = [&](const std::vector<double>& y, bool jacobian) {
+			std::fill(r.begin(), r.end(), 0.);
+			if (jacobian) {
+				std::fill(J.begin(), J.end(), 0.);
+			}
+			for (const auto& x : cf) {
+				double y_ = x.s ? y[x.s - 1] : 0;
+				double cD = x.c * exp(-(y_ + x.w * (y[x.s] - y_)));
+				r[x.k] += cD;
+				if (jacobian) {
+					J[x.a] -= cD * (1 - x.w);
+					J[x.b] -= cD * x.w;
+				}
+			}
+			double cost = 0;
+			for (size_t k = 0; k < n; ++k) {
+				r[k] -= p[k];
+				cost += r[k] * r[k];
+			}
+
+			return cost / 2;
+		};
+		// z = J^T J v
+		const auto JTJ = [&](const std::vector<double>& v, std::vector<double>& z) {
+			std::fill(z.begin(), z.end(), 0.);
+			for (size_t k = 0; k < n; ++k) {
+				double s = 0;
+				for (size_t e = row[k]; e < row[k + 1]; ++e) {
+					s += J[e] * v[col[e]];
+				}
+				for (size_t e = row[k]; e < row[k + 1]; ++e) {
+					z[col[e]] += J[e] * s;
+				}
+			}
+		};
+
+		// y from initial forwards
+		std::vector<double> y(m), y1(m);
+		for (size_t l = 0; l < m; ++l) {
+			y[l] = (l ? y[l - 1] : 0) + f[l] * (t[l] - (l ? t[l - 1] : 0));
+		}
+
+		std::vector<double> g(m), d(m), dy(m), res(m), z(m), q(m), Aq(m);
+		double lambda = 1e-3;
+		double cost = eval(y, true);
+		int iter = 0;
+		const auto max_residual = [&r]() {
+			double e = 0;
+			for (const auto& r_ : r) {
+				e = std::max(e, fabs(r_));
+			}
+			return e;
+		};
+
+		while (iter < max_iterations and max_residual() > tolerance) {
+			// gradient and scaling from the diagonal of J^T J
+			std::fill(g.begin(), g.end(), 0.);
+			std::fill(d.begin(), d.end(), 0.);
+			double dmax = 0;
+			for (size_t k = 0; k < n; ++k) {
+				for (size_t e = row[k]; e < row[k + 1]; ++e) {
+					g[col[e]] += J[e] * r[k];
+					d[col[e]] += J[e] * J[e];
+				}
+			}
+			for (const auto& d_ : d) {
+				dmax = std::max(dmax, d_);
+			}
+			if (dmax == 0) {
+				break;
+			}
+			for (auto& d_ : d) {
+				d_ = std::max(d_, 1e-12 * dmax); // knots no cash flow depends on stay put
+			}
+
+			bool accepted = false;
+			while (!accepted and lambda < 1e12) {
+				// solve (J^T J + lambda diag) dy = -g by preconditioned conjugate gradients
+				const auto A = [&](const std::vector<double>& v, std::vector<double>& Av) {
+					JTJ(v, Av);
+					for (size_t l = 0; l < m; ++l) {
+						Av[l] += lambda * d[l] * v[l];
+					}
+				};
+				std::fill(dy.begin(), dy.end(), 0.);
+				double rz = 0, g2 = 0;
+				for (size_t l = 0; l < m; ++l) {
+					res[l] = -g[l];
+					z[l] = res[l] / ((1 + lambda) * d[l]);
+					q[l] = z[l];
+					rz += res[l] * z[l];
+					g2 += g[l] * g[l];
+				}
+				for (size_t cg = 0; cg < 2 * m and rz > 0; ++cg) {
+					A(q, Aq);
+					double qAq = 0;
+					for (size_t l = 0; l < m; ++l) {
+						qAq += q[l] * Aq[l];
+					}
+					double alpha = rz / qAq;
+					double res2 = 0, rz1 = 0;
+					for (size_t l = 0; l < m; ++l) {
+						dy[l] += alpha * q[l];
+						res[l] -= alpha * Aq[l];
+						res2 += res[l] * res[l];
+						z[l] = res[l] / ((1 + lambda) * d[l]);
+						rz1 += res[l] * z[l];
+					}
+					if (res2 <= 1e-24 * g2) {
+						break;
+					}
+					for (size_t l = 0; l < m; ++l) {
+						q[l] = z[l] + (rz1 / rz) * q[l];
+					}
+					rz = rz1;
+				}
+
+				for (size_t l = 0; l < m; ++l) {
+					y1[l] = y[l] + dy[l];
+				}
+				double cost1 = eval(y1, false);
+				if (cost1 < cost) {
+					accepted = true;
+					std::swap(y, y1);
+					cost = eval(y, true);
+					lambda = std::max(lambda / 3, 1e-12);
+				}
+				else {
+					lambda *= 4;
+				}
+			}
+			if (!accepted) {
+				eval(y, true); // restore residuals at y
+				break;
+			}
+			++iter;
+		}
+
+		stats::count(stats::fit);
+		stats::count(stats::fit_iterations, iter);
+		for (size_t l = 0; l < m; ++l) {
+			f[l] = (y[l] - (l ? y[l - 1] : 0)) / (t[l] - (l ? t[l - 1] : 0));
+		}
+
+		return fit_result{ iter, max_residual() };
+	}
+
+	// Fit a curve that owns its knots at the distinct maturities of the instruments.
+	template<class I>
+	inline auto fit(size_t n, const I* i, const double* p, fit_result* result = nullptr)
+	{
+		auto t = fit_knots(n, i);
+		std::vector<double> f(t.size(), 0.03);
+
+		auto r = fit(t.size(), t.data(), f.data(), n, i, p);
+		if (result) {
+			*result = r;
+		}
+
+		return pwflat::forward(fms::sequence::list(t.size(), t.data()), fms::sequence::list(f.size(), f.data()));
+	}
+
+}
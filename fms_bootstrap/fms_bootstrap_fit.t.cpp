@@ -0,0 +1,75 @@
+// fms_bootstrap_fit.t.cpp - Test least squares fit of all knots.
+#include <cassert>
+#include <vector>
+#include "fms_bootstrap.h"
+#include "fms_instrument.h"
+
+using namespace fms::bootstrap;
+using fms::sequence::list;
+
+int test_bootstrap_fit()
+{
+	using I = fms::instrument::sequence<list<double>, list<double>>;
+
+	// exactly determined strip agrees with sequential bootstrap
+	{
+		I i[] = {
+			fms::instrument::flows(fms::instrument::cash_deposit(0.25, 0.04)),
+			fms::instrument::flows(fms::instrument::forward_rate_agreement(0.25, 0.25, 0.045)),
+			fms::instrument::flows(fms::instrument::interest_rate_swap(1., 2, 0.05)),
+			fms::instrument::flows(fms::instrument::interest_rate_swap(2., 2, 0.05)),
+			fms::instrument::flows(fms::instrument::interest_rate_swap(5., 2, 0.05)),
+		};
+		double p[] = { 0, 0, 0, 0, 0 };
+		auto F = curve(5, i, p);
+
+		fit_result r;
+		auto G = fit(5, i, p, &r);
+		assert(r.residual <= 1e-10);
+		assert(r.iterations > 0);
+		auto t = F.time();
+		auto f = F.rate();
+		auto u = G.time();
+		auto g = G.rate();
+		for (; t; ++t, ++f, ++u, ++g) {
+			assert(*t == *u);
+			assert(fabs(*f - *g) < 1e-8);
+		}
+		assert(!u);
+	}
+	// redundant and overlapping quotes priced off a known curve
+	{
+		auto F = fms::pwflat::forward(list({ 0.5, 1., 2., 3. }), list({ 0.02, 0.025, 0.03, 0.032 }));
+		I i[] = {
+			fms::instrument::flows(fms::instrument::cash_deposit(0.5, 0.03)),
+			fms::instrument::flows(fms::instrument::forward_rate_agreement(0.25, 0.75, 0.03)),
+			fms::instrument::flows(fms::instrument::forward_rate_agreement(0.5, 0.5, 0.03)),
+			fms::instrument::flows(fms::instrument::interest_rate_swap(1., 2, 0.03)),
+			fms::instrument::flows(fms::instrument::interest_rate_swap(2., 2, 0.03)),
+			fms::instrument::flows(fms::instrument::interest_rate_swap(2., 4, 0.025)),
+			fms::instrument::flows(fms::instrument::interest_rate_swap(3., 1, 0.03)),
+			fms::instrument::flows(fms::instrument::interest_rate_swap(3., 2, 0.035)),
+		};
+		const size_t n = sizeof(i) / sizeof(*i);
+		double p[n];
+		for (size_t k = 0; k < n; ++k) {
+			p[k] = pv(F, i[k]);
+		}
+
+		fit_result r;
+		auto G = fit(n, i, p, &r);
+		assert(r.residual <= 1e-10);
+		for (double u : { 0.25, 0.5, 0.9, 1., 1.5, 2.5, 3. }) {
+			assert(fabs(G.value(u) - F.value(u)) < 1e-8);
+		}
+
+		// inconsistent quotes are fit in the least squares sense
+		p[5] += 0.001;
+		fit(n, i, p, &r);
+		assert(r.residual > 1e-5 and r.residual < 0.001);
+		assert(r.iterations < 100);
+	}
+
+	return 0;
+}
+int test_bootstrap_fit_ = test_bootstrap_fit();
@@ -0,0 +1,104 @@
+// fms_bootstrap_lazy.h - Curve bootstrapped on demand up to the furthest time queried.
+#pragma once
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include "fms_span.h"
+#include "fms_bootstrap_extend.h"
+
+namespace fms::bootstrap {
+
+	// Holds an instrument strip and prices and solves knots only as far as queries require.
+	// Knots are written once into storage that never moves and published by an atomic count,
+	// so the built prefix can be read concurrently while another thread extends it.
+	template<class I>
+	class lazy {
+		std::vector<I> i;
+		std::vector<double> p;
+		std::vector<double> t, f; // knots, capacity fixed at construction
+		std::atomic<size_t> n;    // number of published knots
+		std::mutex mutex;         // serializes extension
+	public:
+		using forward = pwflat::forward<span<double>, span<double>>;
+
+		// Instruments must have increasing maturities as for fms::bootstrap::curve.
+		lazy(size_t m, const I* i, const double* p)
+			: i(i, i + m), p(p, p + m), t(m), f(m), n(0)
+		{ }
+		lazy(const lazy&) = delete;
+		lazy& operator=(const lazy&) = delete;
+
+		// Number of instruments.
+		size_t capacity() const
+		{
+			return i.size();
+		}
+		// Number of knots solved so far.
+		size_t size() const
+		{
+			return n.load(std::memory_order_acquire);
+		}
+
+		// Solve knots until the curve covers time u or the strip is exhausted.
+		// Returns the number of published knots.
+		size_t build(double u)
+		{
+			size_t k = size();
+			if (k == i.size() or (k > 0 and t[k - 1] >= u)) {
+				return k;
+			}
+
+			std::lock_guard lock(mutex);
+
+			// extend times each segment, a partial build is not a whole curve
+			k = n.load(std::memory_order_relaxed);
+			while (k < i.size() and (k == 0 or t[k - 1] < u)) {
+				pwflat::forward F(span<double>(k, t.data()), span<double>(k, f.data()));
+				auto [_u, _f] = extend(F, k ? t[k - 1] : 0., p[k], i[k].time(), i[k].cash());
+				if (std::isnan(_u) or std::isnan(_f)) {
+					throw std::runtime_error("fms::bootstrap::lazy: instrument does not extend the curve");
+				}
+				t[k] = _u;
+				f[k] = _f;
+				n.store(++k, std::memory_order_release);
+			}
+
+			return k;
+		}
+
+		// Curve over the knots needed for time u.
+		forward curve(double u)
+		{
+			size_t k = build(u);
+
+			return forward(span<double>(k, t.data()), span<double>(k, f.data()));
+		}
+		// Curve over all knots solved so far.
+		forward curve() const
+		{
+			size_t k = size();
+
+			return forward(span<double>(k, t.data()), span<double>(k, f.data()));
+		}
+
+		double value(double u)
+		{
+			return curve(u).value(u);
+		}
+		double integral(double u)
+		{
+			return curve(u).integral(u);
+		}
+		double discount(double u)
+		{
+			return curve(u).discount(u);
+		}
+		double spot(double u)
+		{
+			return curve(u).spot(u);
+		}
+	};
+
+}
@@ -0,0 +1,69 @@
+// fms_bootstrap_lazy.t.cpp - Test curve bootstrapped on demand.
+#include <cassert>
+#include <thread>
+#include <vector>
+#include "fms_bootstrap.h"
+#include "fms_instrument.h"
+
+using namespace fms::bootstrap;
+using fms::sequence::list;
+
+int test_bootstrap_lazy()
+{
+	using I = fms::instrument::sequence<list<double>, list<double>>;
+
+	I i[] = {
+		fms::instrument::flows(fms::instrument::cash_deposit(0.25, 0.04)),
+		fms::instrument::flows(fms::instrument::forward_rate_agreement(0.25, 0.25, 0.045)),
+		fms::instrument::flows(fms::instrument::interest_rate_swap(1., 2, 0.05)),
+		fms::instrument::flows(fms::instrument::interest_rate_swap(2., 2, 0.05)),
+		fms::instrument::flows(fms::instrument::interest_rate_swap(5., 2, 0.05)),
+	};
+	double p[] = { 0, 0, 0, 0, 0 };
+	auto F = curve(5, i, p);
+
+	{
+		lazy L(5, i, p);
+		assert(L.capacity() == 5);
+		assert(L.size() == 0);
+
+		// short end only solves what it needs
+		assert(L.discount(0.1) == F.discount(0.1));
+		assert(L.size() == 1);
+		assert(L.discount(0.25) == F.discount(0.25));
+		assert(L.size() == 1);
+		assert(L.discount(0.3) == F.discount(0.3));
+		assert(L.size() == 2);
+
+		// earlier queries do not rebuild
+		assert(L.value(0.2) == F.value(0.2));
+		assert(L.size() == 2);
+
+		assert(L.spot(1.5) == F.spot(1.5));
+		assert(L.size() == 4);
+
+		// past the end of the strip
+		assert(L.integral(5) == F.integral(5));
+		assert(L.size() == 5);
+		assert(std::isnan(L.discount(6)));
+		assert(L.size() == 5);
+	}
+	{
+		lazy L(5, i, p);
+		std::vector<std::thread> ts;
+		std::vector<double> D(8);
+		for (size_t k = 0; k < D.size(); ++k) {
+			ts.emplace_back([&L, &D, k]() { D[k] = L.discount(0.5 * k + 0.1); });
+		}
+		for (auto& t : ts) {
+			t.join();
+		}
+		for (size_t k = 0; k < D.size(); ++k) {
+			assert(D[k] == F.discount(0.5 * k + 0.1));
+		}
+		assert(L.size() == 5);
+	}
+
+	return 0;
+}
+int test_bootstrap_lazy_ = test_bootstrap_lazy();
@@ -0,0 +1,340 @@
+// fms_bootstrap_pipeline.h - Stream quotes through parsing, bootstrap and publication stages.
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <istream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../fms_sequence/fms_sequence_list.h"
+#include "fms_bootstrap_curve.h"
+#include "fms_instrument.h"
+
+/*
+	Input is text with one curve set per header line followed by its quotes.
+
+	curve NAME
+	TYPE TENOR FREQUENCY RATE
+
+	TYPE is cd, fra or swap. A cash deposit ignores FREQUENCY. A forward rate
+	agreement starts at TENOR and lasts 1/FREQUENCY years. A swap matures at
+	TENOR and pays FREQUENCY coupons a year. Quotes are par rates so every
+	instrument has price 0. Blank lines and lines starting with # are ignored.
+	TENOR is at most schedule::max_maturity years and FREQUENCY at most
+	schedule::max_frequency so one line can not make a huge coupon grid.
+
+	Each stage runs on its own thread and hands work to the next through a
+	bounded queue. A full queue blocks the stage feeding it so a slow consumer
+	slows the parser instead of buffering the whole input. Curve sets are
+	published in input order.
+*/
+
+namespace fms::bootstrap {
+
+	// Bounded blocking queue. Push blocks while full and pop blocks while empty.
+	template<class T>
+	class bounded_queue {
+		std::deque<T> q;
+		size_t capacity;
+		bool closed;
+		std::mutex mutex;
+		std::condition_variable not_full, not_empty;
+	public:
+		bounded_queue(size_t capacity)
+			: capacity(capacity ? capacity : 1), closed(false)
+		{ }
+
+		void push(T t)
+		{
+			std::unique_lock lock(mutex);
+			not_full.wait(lock, [this]() { return q.size() < capacity; });
+			q.push_back(std::move(t));
+			not_empty.notify_one();
+		}
+		// False once the queue is closed and empty.
+		bool pop(T& t)
+		{
+			std::unique_lock lock(mutex);
+			not_empty.wait(lock, [this]() { return !q.empty() or closed; });
+			if (q.empty()) {
+				return false;
+			}
+			t = std::move(q.front());
+			q.pop_front();
+			not_full.notify_one();
+
+			return true;
+		}
+		// No more pushes. Pops drain what is left.
+		void close()
+		{
+			std::lock_guard lock(mutex);
+			closed = true;
+			not_empty.notify_all();
+		}
+	};
+
+	// Throughput of one pipeline stage. Safe to read while the pipeline runs.
+	struct stage_counters {
+		std::atomic<uint64_t> items = 0;      // curve sets handed on
+		std::atomic<uint64_t> errors = 0;     // curve sets or stray lines dropped
+		std::atomic<uint64_t> busy_ns = 0;    // time spent working
+		std::atomic<uint64_t> blocked_ns = 0; // time waiting on a full queue
+
+		// Curve sets per second of busy time.
+		double rate() const
+		{
+			return busy_ns ? 1e9 * items / busy_ns : 0;
+		}
+	};
+
+	class pipeline {
+	public:
+		using instrument = fms::instrument::sequence<fms::sequence::list<double>, fms::sequence::list<double>>;
+		using forward = pwflat::forward<fms::sequence::list<double>, fms::sequence::list<double>>;
+		using publisher = std::function<void(const std::string& name, forward&& f)>;
+
+		struct quote {
+			char type; // 'c', 'f' or 's'
+			double tenor;
+			int frequency;
+			double rate;
+		};
+
+		enum stage { parse, build, solve, publish, stages };
+	private:
+		struct quotes {
+			std::string name;
+			std::vector<quote> q;
+		};
+		struct instruments {
+			std::string name;
+			std::vector<instrument> i;
+		};
+		struct curve {
+			std::string name;
+			forward f = forward(fms::sequence::list<double>(), fms::sequence::list<double>());
+		};
+
+		publisher pub;
+		size_t capacity;
+		std::array<stage_counters, stages> counters;
+
+		using clock = std::chrono::steady_clock;
+		static uint64_t ns(clock::time_point t0, clock::time_point t1)
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+		}
+
+		// Time work and the push that follows separately.
+		template<class T>
+		void hand_on(stage s, clock::time_point t0, bounded_queue<T>& q, T&& t)
+		{
+			auto t1 = clock::now();
+			q.push(std::move(t));
+			auto t2 = clock::now();
+			counters[s].busy_ns += ns(t0, t1);
+			counters[s].blocked_ns += ns(t1, t2);
+			++counters[s].items;
+		}
+	public:
+		// Call pub with each bootstrapped curve. Queues between stages hold at most capacity curve sets.
+		pipeline(publisher pub, size_t capacity = 64)
+			: pub(std::move(pub)), capacity(capacity)
+		{ }
+
+		const stage_counters& operator[](stage s) const
+		{
+			return counters[s];
+		}
+
+		// Parse one quote line. Returns false if it is malformed.
+		static bool parse_quote(const char* line, quote& q)
+		{
+			char* e;
+			while (*line == ' ' or *line == '\t') {
+				++line;
+			}
+			size_t n = strcspn(line, " \t");
+			if (n == 2 and strncmp(line, "cd", 2) == 0) {
+				q.type = 'c';
+			}
+			else if (n == 3 and strncmp(line, "fra", 3) == 0) {
+				q.type = 'f';
+			}
+			else if (n == 4 and strncmp(line, "swap", 4) == 0) {
+				q.type = 's';
+			}
+			else {
+				return false;
+			}
+			line += n;
+			q.tenor = strtod(line, &e);
+			if (e == line or !(q.tenor > 0) or !(q.tenor <= fms::instrument::schedule::max_maturity)) {
+				return false;
+			}
+			line = e;
+			long f = strtol(line, &e, 10);
+			if (e == line or f < 0 or f > fms::instrument::schedule::max_frequency or (q.type != 'c' and f == 0)) {
+				return false;
+			}
+			q.frequency = static_cast<int>(f);
+			line = e;
+			q.rate = strtod(line, &e);
+			if (e == line or !std::isfinite(q.rate)) {
+				return false;
+			}
+			while (*e == ' ' or *e == '\t' or *e == '\r') {
+				++e;
+			}
+
+			return *e == 0;
+		}
+
+		// Instrument for a quote.
+		static instrument make(const quote& q)
+		{
+			switch (q.type) {
+			case 'c':
+				return fms::instrument::flows(fms::instrument::cash_deposit(q.tenor, q.rate));
+			case 'f':
+				return fms::instrument::flows(fms::instrument::forward_rate_agreement(q.tenor, 1. / q.frequency, q.rate));
+			default:
+				return fms::instrument::flows(fms::instrument::interest_rate_swap(q.tenor, q.frequency, q.rate));
+			}
+		}
+
+		// Run all stages until is is exhausted and every curve is published.
+		// Returns the number of curves published by this run.
+		size_t run(std::istream& is)
+		{
+			const size_t published = counters[publish].items;
+
+			bounded_queue<quotes> q0(capacity);
+			bounded_queue<instruments> q1(capacity);
+			bounded_queue<curve> q2(capacity);
+
+			std::thread building([&]() {
+				quotes qs;
+				while (q0.pop(qs)) {
+					auto t0 = clock::now();
+					instruments set{ std::move(qs.name), {} };
+					try {
+						set.i.reserve(qs.q.size());
+						for (const auto& q : qs.q) {
+							set.i.push_back(make(q));
+						}
+					}
+					catch (const std::exception&) {
+						++counters[build].errors;
+						counters[build].busy_ns += ns(t0, clock::now());
+						continue;
+					}
+					hand_on(build, t0, q1, std::move(set));
+				}
+				q1.close();
+			});
+			std::thread solving([&]() {
+				instruments set;
+				std::vector<double> p;
+				while (q1.pop(set)) {
+					auto t0 = clock::now();
+					p.assign(set.i.size(), 0.);
+					try {
+						auto f = bootstrap::curve(set.i.size(), set.i.data(), p.data());
+						hand_on(solve, t0, q2, curve{ std::move(set.name), std::move(f) });
+					}
+					catch (const std::exception&) {
+						++counters[solve].errors;
+						counters[solve].busy_ns += ns(t0, clock::now());
+					}
+				}
+				q2.close();
+			});
+			std::thread publishing([&]() {
+				curve c;
+				while (q2.pop(c)) {
+					auto t0 = clock::now();
+					try {
+						pub(c.name, std::move(c.f));
+						++counters[publish].items;
+					}
+					catch (const std::exception&) {
+						++counters[publish].errors;
+					}
+					counters[publish].busy_ns += ns(t0, clock::now());
+				}
+			});
+
+			// parse on the calling thread
+			{
+				std::string line;
+				quotes qs;
+				bool bad = false; // current set has a malformed quote
+				auto t0 = clock::now();
+				const auto flush = [&]() {
+					if (!qs.name.empty()) {
+						if (bad) {
+							++counters[parse].errors;
+						}
+						else {
+							hand_on(parse, t0, q0, std::move(qs));
+							t0 = clock::now();
+						}
+					}
+					qs = quotes{};
+					bad = false;
+				};
+				while (std::getline(is, line)) {
+					const char* s = line.c_str();
+					while (*s == ' ' or *s == '\t') {
+						++s;
+					}
+					if (*s == 0 or *s == '\r' or *s == '#') {
+						continue;
+					}
+					if (strncmp(s, "curve", 5) == 0 and (s[5] == ' ' or s[5] == '\t')) {
+						flush();
+						s += 5;
+						while (*s == ' ' or *s == '\t') {
+							++s;
+						}
+						qs.name.assign(s, strcspn(s, " \t\r"));
+						bad = qs.name.empty();
+						if (bad) {
+							qs.name = "?";
+						}
+						continue;
+					}
+					quote q;
+					if (qs.name.empty() or !parse_quote(s, q)) {
+						bad = true;
+						if (qs.name.empty()) {
+							++counters[parse].errors;
+						}
+						continue;
+					}
+					qs.q.push_back(q);
+				}
+				flush();
+			}
+			q0.close();
+
+			building.join();
+			solving.join();
+			publishing.join();
+
+			return counters[publish].items - published;
+		}
+	};
+
+}
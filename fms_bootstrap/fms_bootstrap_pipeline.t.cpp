@@ -0,0 +1,109 @@
+// fms_bootstrap_pipeline.t.cpp - Test streaming quotes to published curves.
+#include <cassert>
+#include <chrono>
+#include <map>
+#include <sstream>
+#include <thread>
+#include "fms_bootstrap_pipeline.h"
+
+using namespace fms::bootstrap;
+
+int test_bootstrap_pipeline_parse()
+{
+	pipeline::quote q;
+	assert(pipeline::parse_quote("swap 5 2 0.03", q));
+	assert(q.type == 's' and q.tenor == 5 and q.frequency == 2 and q.rate == 0.03);
+	assert(pipeline::parse_quote("  cd 0.25 0 0.02\r", q));
+	assert(q.type == 'c' and q.tenor == 0.25);
+	assert(pipeline::parse_quote("fra 0.5 4 0.025", q));
+	assert(q.type == 'f' and q.frequency == 4);
+
+	assert(!pipeline::parse_quote("bond 5 2 0.03", q));
+	assert(!pipeline::parse_quote("swap 5 0 0.03", q));
+	assert(!pipeline::parse_quote("swap -1 2 0.03", q));
+	assert(!pipeline::parse_quote("swap 5 2", q));
+	assert(!pipeline::parse_quote("swap 5 2 0.03 x", q));
+	assert(!pipeline::parse_quote("swap 5 2 nan", q));
+	assert(!pipeline::parse_quote("swap 5 2 -inf", q));
+	assert(!pipeline::parse_quote("swap inf 2 0.03", q));
+	// tenor and frequency are bounded so one line can not stall the build stage
+	assert(pipeline::parse_quote("swap 100 365 0.03", q));
+	assert(!pipeline::parse_quote("swap 1e12 1 0.03", q));
+	assert(!pipeline::parse_quote("swap 5 366 0.03", q));
+	assert(!pipeline::parse_quote("cd 1 99999999999 0.03", q));
+
+	return 0;
+}
+int test_bootstrap_pipeline_parse_ = test_bootstrap_pipeline_parse();
+
+int test_bootstrap_pipeline()
+{
+	using fms::instrument::cash_deposit;
+	using fms::instrument::forward_rate_agreement;
+	using fms::instrument::interest_rate_swap;
+
+	std::map<std::string, pipeline::forward> curves;
+	pipeline pl([&](const std::string& name, pipeline::forward&& f) { curves.insert_or_assign(name, std::move(f)); }, 2);
+
+	std::istringstream is(R"(# two good sets, three bad quotes and two sets that do not bootstrap
+curve USD
+cd 0.25 0 0.02
+fra 0.25 4 0.025
+swap 2 2 0.03
+
+curve EUR
+cd 0.5 0 0.01
+swap 3 1 0.015
+curve BAD
+cd 0.5 0 0.01
+swap 3 x 0.015
+curve DOWN
+swap 3 1 0.015
+cd 0.5 0 0.01
+curve NOROOT
+cd 0.5 0 0.01
+swap 3 1 -5
+curve NAN
+swap 5 2 nan
+curve HUGE
+swap 1e12 1 0.03
+)");
+	assert(pl.run(is) == 2);
+	assert(curves.size() == 2);
+	assert(pl[pipeline::parse].items == 4 and pl[pipeline::parse].errors == 3);
+	assert(pl[pipeline::build].items == 4 and pl[pipeline::build].errors == 0);
+	assert(pl[pipeline::solve].items == 2 and pl[pipeline::solve].errors == 2);
+	assert(pl[pipeline::publish].items == 2);
+
+	// same as bootstrapping directly
+	{
+		pipeline::instrument i[] = {
+			fms::instrument::flows(cash_deposit(0.25, 0.02)),
+			fms::instrument::flows(forward_rate_agreement(0.25, 0.25, 0.025)),
+			fms::instrument::flows(interest_rate_swap(2., 2, 0.03)),
+		};
+		double p[] = { 0, 0, 0 };
+		auto f = curve(3, i, p);
+		for (double u : { 0.1, 0.3, 1., 1.9 }) {
+			assert(curves.at("USD").discount(u) == f.discount(u));
+		}
+	}
+
+	// a slow publisher blocks the earlier stages instead of buffering the input
+	std::ostringstream os;
+	for (int k = 0; k < 20; ++k) {
+		os << "curve C" << k << "\ncd 1 0 0.0" << (k % 9 + 1) << "\n";
+	}
+	std::istringstream slow(os.str());
+	size_t n = 0;
+	pipeline sp([&](const std::string&, pipeline::forward&&) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		++n;
+	}, 1);
+	assert(sp.run(slow) == 20 and n == 20);
+	assert(sp[pipeline::parse].blocked_ns > 0);
+	assert(sp[pipeline::publish].rate() > 0);
+
+	return 0;
+}
+int test_bootstrap_pipeline_ = test_bootstrap_pipeline();
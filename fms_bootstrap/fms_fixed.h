@@ -0,0 +1,53 @@
+// fms_fixed.h - Sequence of at most N values stored inline.
+// Copying a fixed sequence copies N values so it never allocates.
+#pragma once
+#include <compare>
+#include <cstddef>
+#include <initializer_list>
+#include <stdexcept>
+
+namespace fms {
+
+	template<class T, size_t N>
+	class fixed {
+		T a[N];
+		size_t i, n;
+	public:
+		fixed()
+			: a{}, i(0), n(0)
+		{ }
+		fixed(std::initializer_list<T> l)
+			: a{}, i(0), n(l.size())
+		{
+			if (n > N) {
+				throw std::length_error("fms::fixed: too many values");
+			}
+			size_t j = 0;
+			for (const auto& x : l) {
+				a[j++] = x;
+			}
+		}
+		auto operator<=>(const fixed&) const = default;
+		explicit operator bool() const
+		{
+			return i < n;
+		}
+		const T& operator*() const
+		{
+			return a[i];
+		}
+		fixed& operator++()
+		{
+			if (i < n) {
+				++i;
+			}
+
+			return *this;
+		}
+		size_t size() const
+		{
+			return n - i;
+		}
+	};
+
+}
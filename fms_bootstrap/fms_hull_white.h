@@ -0,0 +1,266 @@
+// fms_hull_white.h - Monte Carlo short rate paths fitted to a piecewise flat forward curve.
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "fms_pwflat.h"
+#include "fms_pwflat_plan.h"
+
+/*
+	Hull-White short rate dr = (theta(t) - a r) dt + sigma dW is r = x + phi where
+	dx = -a x dt + sigma dW, x(0) = 0, and phi fits the initial curve f:
+
+	int_0^t phi = int_0^t f + V(t)/2, V(t) = Var(int_0^t x) = sigma^2/a^2 (t - 2 B(t) + B_2(t))
+
+	with B(t) = (1 - e^{-a t})/a and B_2(t) = (1 - e^{-2 a t})/(2 a). The pathwise
+	discount to t is D(t) = exp(-Y(t) - int_0^t phi) where Y = int x, so E[D(t)] = exp(-int_0^t f).
+
+	(x, Y) is Gaussian so each step of the grid is sampled exactly:
+	x' = e^{-a dt} x + e_1, Y' = Y + B(dt) x + e_2 with
+	Var e_1 = sigma^2 B_2(dt), Var e_2 = V(dt), Cov(e_1, e_2) = sigma^2 B(dt)^2/2.
+
+	The integrals of f at grid times come from a plan over the knots of f.
+	Paths are simulated in batches stored as structure of arrays so the step
+	loop runs over contiguous paths and vectorizes. Batches are independent
+	and seeded by their index so results do not depend on the number of threads.
+*/
+
+namespace fms::hull_white {
+
+	struct model {
+		double a;     // mean reversion
+		double sigma; // short rate volatility
+	};
+
+	// (1 - e^{-a t})/a
+	inline double B(double a, double t)
+	{
+		return a == 0 ? t : -expm1(-a * t) / a;
+	}
+	// Variance of int_0^t x.
+	inline double V(const model& m, double t)
+	{
+		double at = m.a * t;
+		double s2 = m.sigma * m.sigma;
+		if (fabs(at) < 1e-3) {
+			// series avoids cancellation
+			return s2 * t * t * t * (1. / 3 - at / 4 + 7 * at * at / 60);
+		}
+
+		return s2 / (m.a * m.a) * (t - 2 * B(m.a, t) + B(2 * m.a, t));
+	}
+
+	// Uniform random numbers from xoshiro256+.
+	class rng {
+		uint64_t s[4];
+
+		static uint64_t splitmix(uint64_t& x)
+		{
+			uint64_t z = (x += 0x9e3779b97f4a7c15);
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+
+			return z ^ (z >> 31);
+		}
+		static uint64_t rotl(uint64_t x, int k)
+		{
+			return (x << k) | (x >> (64 - k));
+		}
+	public:
+		rng(uint64_t seed, uint64_t stream = 0)
+		{
+			uint64_t x = seed ^ (stream * 0xd1342543de82ef95);
+			for (auto& si : s) {
+				si = splitmix(x);
+			}
+		}
+		uint64_t operator()()
+		{
+			uint64_t r = s[0] + s[3];
+			uint64_t t = s[1] << 17;
+			s[2] ^= s[0];
+			s[3] ^= s[1];
+			s[1] ^= s[2];
+			s[0] ^= s[3];
+			s[2] ^= t;
+			s[3] = rotl(s[3], 45);
+
+			return r;
+		}
+		// Uniform in (0, 1].
+		double uniform()
+		{
+			return ((*this)() >> 11) * 0x1p-53 + 0x1p-53;
+		}
+		// n standard normals by Box-Muller, n even.
+		void normal(size_t n, double* z)
+		{
+			constexpr double two_pi = 6.283185307179586;
+			for (size_t i = 0; i + 1 < n; i += 2) {
+				double r = sqrt(-2 * log(uniform()));
+				double t = two_pi * uniform();
+				z[i] = r * cos(t);
+				z[i + 1] = r * sin(t);
+			}
+		}
+	};
+
+	class simulation {
+		model m;
+		std::vector<double> t;   // grid times, increasing and positive
+		std::vector<double> Phi; // int_0^t phi at grid times
+		// per step: x decay, Y loading on x, and Cholesky factor of (e_1, e_2)
+		std::vector<double> e, b, s11, s21, s22;
+	public:
+		// Fit to curve f and sample at n increasing positive times.
+		// The curve needs an extrapolation if the grid goes past its last knot.
+		template<class T, class F>
+		simulation(const pwflat::forward<T, F>& f, const model& m, size_t n, const double* grid)
+			: m(m), t(grid, grid + n), Phi(n), e(n), b(n), s11(n), s21(n), s22(n)
+		{
+			for (size_t k = 0; k < n; ++k) {
+				if (!(t[k] > (k ? t[k - 1] : 0))) {
+					throw std::runtime_error("fms::hull_white::simulation: grid times must be positive and increasing");
+				}
+			}
+
+			pwflat::plan(f.time(), n, grid).integral(f, Phi.data());
+			double s2 = m.sigma * m.sigma;
+			for (size_t k = 0; k < n; ++k) {
+				Phi[k] += V(m, t[k]) / 2;
+
+				double dt = t[k] - (k ? t[k - 1] : 0);
+				e[k] = exp(-m.a * dt);
+				b[k] = B(m.a, dt);
+				double v1 = s2 * B(2 * m.a, dt);
+				double v2 = V(m, dt);
+				double c = s2 * b[k] * b[k] / 2;
+				s11[k] = sqrt(v1);
+				s21[k] = s11[k] > 0 ? c / s11[k] : 0;
+				s22[k] = sqrt(std::max(0., v2 - s21[k] * s21[k]));
+			}
+		}
+
+		size_t size() const
+		{
+			return t.size();
+		}
+		const double* time() const
+		{
+			return t.data();
+		}
+
+		// Simulate paths in batches of at most batch on threads threads, 0 for all cores.
+		// For each batch call op(first, count, D) where D[k * count + p] is the discount
+		// to time k on path first + p. op is called concurrently from different threads.
+		template<class Op>
+		void run(size_t paths, uint64_t seed, Op op, size_t batch = 256, unsigned threads = 0) const
+		{
+			batch = std::max<size_t>(2, batch + batch % 2);
+			size_t batches = (paths + batch - 1) / batch;
+			if (threads == 0) {
+				threads = std::max(1u, std::thread::hardware_concurrency());
+			}
+			threads = static_cast<unsigned>(std::min<size_t>(threads, batches));
+
+			std::atomic<size_t> next = 0;
+			const auto work = [&]() {
+				std::vector<double> x(batch), Y(batch), z(2 * batch), D(t.size() * batch);
+				for (size_t j; (j = next++) < batches; ) {
+					size_t first = j * batch;
+					size_t count = std::min(batch, paths - first);
+					rng g(seed, j);
+					std::fill(x.begin(), x.end(), 0.);
+					std::fill(Y.begin(), Y.end(), 0.);
+					for (size_t k = 0; k < t.size(); ++k) {
+						g.normal(2 * batch, z.data());
+						const double ek = e[k], bk = b[k], s11k = s11[k], s21k = s21[k], s22k = s22[k], Phik = Phi[k];
+						double* Dk = D.data() + k * count;
+						const double* z1 = z.data();
+						const double* z2 = z.data() + batch;
+						for (size_t p = 0; p < count; ++p) {
+							Y[p] += bk * x[p] + s21k * z1[p] + s22k * z2[p];
+							x[p] = ek * x[p] + s11k * z1[p];
+							Dk[p] = exp(-Y[p] - Phik);
+						}
+					}
+					op(first, count, static_cast<const double*>(D.data()));
+				}
+			};
+
+			std::vector<std::thread> ts;
+			for (unsigned i = 1; i < threads; ++i) {
+				ts.emplace_back(work);
+			}
+			work();
+			for (auto& th : ts) {
+				th.join();
+			}
+		}
+	};
+
+	// Sorted distinct positive cash flow times of n instruments.
+	template<class I>
+	inline std::vector<double> times(size_t n, const I* i)
+	{
+		std::vector<double> u;
+		for (size_t k = 0; k < n; ++k) {
+			for (auto uk = i[k].time(); uk; ++uk) {
+				if (*uk > 0) {
+					u.push_back(*uk);
+				}
+			}
+		}
+		std::sort(u.begin(), u.end());
+		u.erase(std::unique(u.begin(), u.end()), u.end());
+
+		return u;
+	}
+
+	// Present value on each path of n instruments with cash flows on the grid
+	// of s or at time 0. Only one batch of discounts is held per thread.
+	template<class I>
+	inline std::vector<double> pv(const simulation& s, size_t n, const I* i, size_t paths, uint64_t seed, unsigned threads = 0)
+	{
+		// cash flows summed by grid time, time 0 flows are not discounted
+		std::vector<double> c(s.size(), 0.);
+		double c0 = 0;
+		const double* t = s.time();
+		for (size_t k = 0; k < n; ++k) {
+			auto u = i[k].time();
+			auto a = i[k].cash();
+			for (; u and a; ++u, ++a) {
+				if (*u == 0) {
+					c0 += *a;
+					continue;
+				}
+				const double* j = std::lower_bound(t, t + s.size(), *u);
+				if (j == t + s.size() or *j != *u) {
+					throw std::runtime_error("fms::hull_white::pv: cash flow time not on the grid");
+				}
+				c[j - t] += *a;
+			}
+		}
+
+		std::vector<double> v(paths);
+		s.run(paths, seed, [&](size_t first, size_t count, const double* D) {
+			double* vp = v.data() + first;
+			std::fill(vp, vp + count, c0);
+			for (size_t k = 0; k < s.size(); ++k) {
+				if (c[k] != 0) {
+					const double* Dk = D + k * count;
+					for (size_t p = 0; p < count; ++p) {
+						vp[p] += c[k] * Dk[p];
+					}
+				}
+			}
+		}, 256, threads);
+
+		return v;
+	}
+
+}
@@ -0,0 +1,138 @@
+// fms_hull_white.t.cpp - Test Hull-White paths fitted to a curve.
+#include <cassert>
+#include <cmath>
+#include <mutex>
+#include <vector>
+#include "../fms_sequence/fms_sequence_list.h"
+#include "fms_bootstrap.h"
+#include "fms_instrument.h"
+#include "fms_hull_white.h"
+
+using namespace fms;
+using fms::sequence::list;
+
+int test_hull_white_variance()
+{
+	// series and closed form agree where they switch
+	hull_white::model m{ 0.1, 0.01 };
+	double t = 1e-3 / m.a;
+	double a = m.a;
+	double closed = m.sigma * m.sigma / (a * a) * (t - 2 * hull_white::B(a, t) + hull_white::B(2 * a, t));
+	assert(fabs(hull_white::V(m, t) - closed) <= 1e-6 * closed);
+	// Ho-Lee
+	assert(fabs(hull_white::V({ 0, 0.01 }, 2) - 0.0001 * 8 / 3) < 1e-18);
+
+	return 0;
+}
+int test_hull_white_variance_ = test_hull_white_variance();
+
+int test_hull_white()
+{
+	auto f = pwflat::forward(list({ 1., 2., 5., 10. }), list({ 0.02, 0.025, 0.03, 0.035 }), 0.035);
+	std::vector<double> grid;
+	for (int k = 1; k <= 48; ++k) {
+		grid.push_back(0.25 * k);
+	}
+
+	// no volatility reproduces the curve on every path
+	{
+		hull_white::simulation s(f, { 0.1, 0 }, grid.size(), grid.data());
+		s.run(10, 1, [&](size_t, size_t count, const double* D) {
+			for (size_t k = 0; k < grid.size(); ++k) {
+				for (size_t p = 0; p < count; ++p) {
+					assert(fabs(D[k * count + p] - f.discount(grid[k])) < 1e-14);
+				}
+			}
+		});
+	}
+
+	// mean discount is the curve discount within a few standard errors
+	for (hull_white::model m : { hull_white::model{ 0.1, 0.01 }, hull_white::model{ 0, 0.01 } }) {
+		hull_white::simulation s(f, m, grid.size(), grid.data());
+		const size_t paths = 20'000;
+		std::vector<double> sum(grid.size()), sum2(grid.size());
+		std::mutex mutex;
+		s.run(paths, 42, [&](size_t, size_t count, const double* D) {
+			std::lock_guard lock(mutex);
+			for (size_t k = 0; k < grid.size(); ++k) {
+				for (size_t p = 0; p < count; ++p) {
+					sum[k] += D[k * count + p];
+					sum2[k] += D[k * count + p] * D[k * count + p];
+				}
+			}
+		});
+		for (size_t k = 0; k < grid.size(); ++k) {
+			double mean = sum[k] / paths;
+			double se = sqrt((sum2[k] / paths - mean * mean) / paths);
+			assert(fabs(mean - f.discount(grid[k])) < 4 * se);
+		}
+	}
+
+	// paths do not depend on the number of threads
+	{
+		hull_white::simulation s(f, { 0.05, 0.01 }, grid.size(), grid.data());
+		std::vector<double> v1(1000), v4(1000);
+		s.run(1000, 7, [&](size_t first, size_t count, const double* D) {
+			std::copy(D + 47 * count, D + 48 * count, v1.begin() + first);
+		}, 100, 1);
+		s.run(1000, 7, [&](size_t first, size_t count, const double* D) {
+			std::copy(D + 47 * count, D + 48 * count, v4.begin() + first);
+		}, 100, 4);
+		assert(v1 == v4);
+	}
+
+	try {
+		double bad[] = { 1, 1 };
+		hull_white::simulation s(f, { 0.1, 0.01 }, 2, bad);
+		assert(false);
+	}
+	catch (const std::runtime_error&) {
+	}
+
+	return 0;
+}
+int test_hull_white_ = test_hull_white();
+
+int test_hull_white_pv()
+{
+	auto f = pwflat::forward(list({ 1., 2., 5., 10. }), list({ 0.02, 0.025, 0.03, 0.035 }), 0.035);
+	std::vector<instrument::sequence<list<double>, list<double>>> book;
+	for (int k = 1; k <= 10; ++k) {
+		book.push_back(instrument::flows(instrument::interest_rate_swap(double(k), 2, 0.03)));
+	}
+	book.push_back(instrument::flows(instrument::cash_deposit(0.25, 0.02)));
+
+	auto grid = hull_white::times(book.size(), book.data());
+	assert(grid.front() == 0.25 and grid.back() == 10);
+	hull_white::simulation s(f, { 0.1, 0.01 }, grid.size(), grid.data());
+
+	const size_t paths = 20'000;
+	auto v = hull_white::pv(s, book.size(), book.data(), paths, 3);
+	assert(v.size() == paths);
+
+	double exact = 0;
+	for (const auto& i : book) {
+		exact += bootstrap::pv(f, i);
+	}
+	double mean = 0, m2 = 0;
+	for (double x : v) {
+		mean += x;
+		m2 += x * x;
+	}
+	mean /= paths;
+	double se = sqrt((m2 / paths - mean * mean) / paths);
+	assert(fabs(mean - exact) < 4 * se);
+
+	// cash flows off the grid
+	double coarse[] = { 1, 2 };
+	hull_white::simulation c(f, { 0.1, 0.01 }, 2, coarse);
+	try {
+		hull_white::pv(c, book.size(), book.data(), 10, 3);
+		assert(false);
+	}
+	catch (const std::runtime_error&) {
+	}
+
+	return 0;
+}
+int test_hull_white_pv_ = test_hull_white_pv();
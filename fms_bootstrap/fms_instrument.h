@@ -5,3 +5,5 @@
 #include "fms_instrument_cd.h"
 #include "fms_instrument_fra.h"
 #include "fms_instrument_swap.h"
+#include "fms_instrument_float.h"
+#include "fms_instrument_day.h"
@@ -114,4 +114,74 @@ int test_instrument_swap()
 
 	return 0;
 }
-int test_instrument_swap_int_int_int = test_instrument_swap<double, double, int>()
\ No newline at end of file
+int test_instrument_swap_int_int_int = test_instrument_swap<double, double, int>();
+
+int test_instrument_swap_schedule()
+{
+	interest_rate_swap s2(2., 4, 0.03), s10(10., 4, 0.05), s1(1., 2, 0.03);
+
+	// swaps with the same frequency share a grid
+	assert(s2.time().grid() == s10.time().grid());
+	assert(s2.time().grid() != s1.time().grid());
+	assert(s10.time().count() == 40);
+
+	// closed form count agrees with stepping through the grid
+	for (int q : { 1, 2, 3, 4, 12, 52, 365 }) {
+		for (double m : { 0., 0.01, 1 / 3., 0.5, 1., 1.1, 2.25, 7 / 12., 10., 29.99, 30., 100. }) {
+			size_t i = 1;
+			while (double(i) / q < m) {
+				++i;
+			}
+			assert(schedule::count(m, q) == i);
+		}
+	}
+	assert(schedule::count(1e12, 1) == 1'000'000'000'000);
+	try {
+		schedule::count(1e300, 12);
+		assert(false);
+	}
+	catch (const std::invalid_argument&) {
+	}
+
+	// stub period pays principal only
+	interest_rate_swap stub(1.1, 2, 0.03);
+	auto u = stub.time();
+	auto c = stub.cash();
+	assert(length(u) == 4 and length(c) == 4);
+	assert(*back(u) == 1.1);
+	assert(*back(c) == 1);
+
+	return 0;
+}
+int test_instrument_swap_schedule_ = test_instrument_swap_schedule();
+
+int test_instrument_day()
+{
+	auto cd = day::cash_deposit(91, 0.0365);
+	assert(std::pair(91, 1 + 0.0365 * 91 / 365) == *++cd);
+
+	auto swap = day::interest_rate_swap(730, 4, 0.04);
+	int u[] = { 0, 91, 183, 274, 365, 456, 548, 639, 730 };
+	for (int i = 0; i < 9; ++i) {
+		assert(swap);
+		auto [u_, c_] = *swap;
+		assert(u[i] == u_);
+		assert(c_ == (i == 0 ? -1 : i == 8 ? 1.01 : 0.01));
+		++swap;
+	}
+	assert(!swap);
+
+	// 10 year monthly swap ends exactly on maturity
+	auto s = day::years(day::interest_rate_swap(3650, 12, 0.05));
+	auto t = s.time();
+	assert(*back(t) == 10);
+	assert(length(t) == 121);
+
+	// stub period
+	auto stub = day::interest_rate_swap(400, 1, 0.05);
+	auto c = stub.cash();
+	assert(*back(c) == 1);
+
+	return 0;
+}
+int test_instrument_day_ = test_instrument_day();
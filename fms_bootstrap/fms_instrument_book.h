@@ -0,0 +1,150 @@
+// fms_instrument_book.h - Cash deposits, forward rate agreements, and swaps stored by column.
+// A trade is a row of kind, start, tenor, rate, frequency, and number of coupon grid times.
+// Cash deposits and swaps start at 0 and only swaps have a frequency and grid times.
+// No memory is allocated per trade.
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "../fms_sequence/fms_sequence_list.h"
+#include "fms_instrument_cd.h"
+#include "fms_instrument_fra.h"
+#include "fms_instrument_swap.h"
+
+namespace fms::instrument {
+
+	class book {
+	public:
+		enum kind : uint8_t {
+			cash_deposit,
+			forward_rate_agreement,
+			interest_rate_swap,
+		};
+	private:
+		std::vector<kind> kind_;
+		std::vector<double> start_, tenor_, rate_;
+		std::vector<int> frequency_;
+		std::vector<size_t> count_;
+
+		void push_back(kind k, double start, double tenor, double rate, int frequency = 0, size_t count = 0)
+		{
+			if (!(start >= 0) or !(tenor > 0) or !std::isfinite(start + tenor)) {
+				throw std::invalid_argument("fms::instrument::book: start must be non-negative and tenor positive");
+			}
+			if (!std::isfinite(rate)) {
+				throw std::invalid_argument("fms::instrument::book: rate must be finite");
+			}
+
+			kind_.push_back(k);
+			start_.push_back(start);
+			tenor_.push_back(tenor);
+			rate_.push_back(rate);
+			frequency_.push_back(frequency);
+			count_.push_back(count);
+		}
+	public:
+		size_t size() const
+		{
+			return kind_.size();
+		}
+		void reserve(size_t n)
+		{
+			kind_.reserve(n);
+			start_.reserve(n);
+			tenor_.reserve(n);
+			rate_.reserve(n);
+			frequency_.reserve(n);
+			count_.reserve(n);
+		}
+
+		book& add_cash_deposit(double tenor, double rate)
+		{
+			push_back(cash_deposit, 0, tenor, rate);
+
+			return *this;
+		}
+		book& add_forward_rate_agreement(double effective, double tenor, double forward)
+		{
+			push_back(forward_rate_agreement, effective, tenor, forward);
+
+			return *this;
+		}
+		book& add_interest_rate_swap(double maturity, int frequency, double coupon)
+		{
+			if (frequency <= 0 or frequency > schedule::max_frequency or !(maturity > 0) or !(maturity <= schedule::max_maturity)) {
+				throw std::invalid_argument("fms::instrument::book: swap frequency and maturity must be positive and in range");
+			}
+			push_back(interest_rate_swap, 0, maturity, coupon, frequency, schedule::count(maturity, frequency));
+
+			return *this;
+		}
+
+		// Columns
+		const kind* kinds() const
+		{
+			return kind_.data();
+		}
+		const double* start() const
+		{
+			return start_.data();
+		}
+		const double* tenor() const
+		{
+			return tenor_.data();
+		}
+		const double* rate() const
+		{
+			return rate_.data();
+		}
+		const int* frequency() const
+		{
+			return frequency_.data();
+		}
+		// Swap grid times i/frequency < maturity.
+		const size_t* grid_count() const
+		{
+			return count_.data();
+		}
+
+		// Number of trades of kind k.
+		size_t count(kind k) const
+		{
+			size_t n = 0;
+			for (auto kk : kind_) {
+				n += kk == k;
+			}
+
+			return n;
+		}
+
+		// Swap in row j.
+		auto swap(size_t j) const
+		{
+			return instrument::interest_rate_swap<>(tenor_[j], frequency_[j], rate_[j]);
+		}
+
+		// Cash flows of row j.
+		auto flows(size_t j) const
+		{
+			using list = fms::sequence::list<double>;
+
+			switch (kind_[j]) {
+			case cash_deposit:
+				return instrument::flows(instrument::cash_deposit(tenor_[j], rate_[j]));
+			case forward_rate_agreement:
+				return instrument::flows(instrument::forward_rate_agreement(start_[j], tenor_[j], rate_[j]));
+			default:
+				list u, c;
+				for (auto s = swap(j); s; ++s) {
+					const auto& [uj, cj] = *s;
+					u.push_back(uj);
+					c.push_back(cj);
+				}
+
+				return sequence<list, list>(u, c);
+			}
+		}
+	};
+
+}
@@ -0,0 +1,70 @@
+// fms_instrument_day.h - Instruments with cash flow times in integer days.
+// Year fractions are day/basis. Schedules are computed from the coupon
+// index so there is no floating point drift and maturity is matched exactly.
+#pragma once
+#include <cassert>
+#include "fms_instrument_sequence.h"
+
+namespace fms::instrument::day {
+
+	using time = fms::sequence::list<int>;
+	using cash = fms::sequence::list<double>;
+
+	// Cash flows (0, -1) and (tenor, 1 + rate*tenor/basis).
+	inline auto cash_deposit(int tenor, double rate, int basis = 365)
+	{
+		assert(tenor > 0);
+
+		return sequence(time({ 0, tenor }), cash({ -1, 1 + rate * tenor / basis }));
+	}
+
+	// Cash flows (effective, -1) and (effective + tenor, 1 + forward*tenor/basis).
+	inline auto forward_rate_agreement(int effective, int tenor, double forward, int basis = 365)
+	{
+		assert(effective >= 0);
+		assert(tenor > 0);
+
+		return sequence(time({ effective, effective + tenor }), cash({ -1, 1 + forward * tenor / basis }));
+	}
+
+	// Coupon day i*basis/frequency rounded to the nearest day.
+	inline int coupon_day(int i, int frequency, int basis = 365)
+	{
+		return (2 * i * basis + frequency) / (2 * frequency);
+	}
+
+	// Cash flows -1 at 0, coupon/frequency at coupon days before maturity, and
+	// 1 + coupon/frequency at maturity if it is a coupon day, otherwise 1.
+	inline auto interest_rate_swap(int maturity, int frequency, double coupon, int basis = 365)
+	{
+		assert(maturity > 0);
+		assert(frequency > 0);
+
+		time u({ 0 });
+		cash c({ -1 });
+
+		int i = 1;
+		for (; coupon_day(i, frequency, basis) < maturity; ++i) {
+			u.push_back(coupon_day(i, frequency, basis));
+			c.push_back(coupon / frequency);
+		}
+		u.push_back(maturity);
+		c.push_back(coupon_day(i, frequency, basis) == maturity ? 1 + coupon / frequency : 1);
+
+		return sequence(u, c);
+	}
+
+	// Instrument with times converted to year fractions for bootstrapping.
+	template<class U, class C>
+	inline auto years(const sequence<U, C>& i, int basis = 365)
+	{
+		fms::sequence::list<double> u;
+
+		for (auto d = i.time(); d; ++d) {
+			u.push_back(static_cast<double>(*d) / basis);
+		}
+
+		return sequence(u, i.cash());
+	}
+
+}
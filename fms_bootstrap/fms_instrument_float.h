@@ -0,0 +1,84 @@
+// fms_instrument_float.h - Instruments with a float leg projected off a separate curve.
+// A float leg with times v_0 < v_1 < ... < v_n pays notional (P(v_{k-1})/P(v_k) - 1)
+// at v_k where P is the projection curve discount. Fixed cash flows and float leg
+// payments are discounted on the discount curve.
+#pragma once
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include "../fms_sequence/fms_sequence.h"
+#include "fms_instrument_sequence.h"
+#include "fms_instrument_swap.h"
+
+namespace fms::instrument {
+
+	// Reset and payment times of a float leg.
+	template<class V = fms::sequence::list<double>>
+	class float_leg {
+		V v;
+		double n;
+	public:
+		float_leg(const V& v, double notional = 1)
+			: v(v), n(notional)
+		{ }
+		const V& time() const
+		{
+			return v;
+		}
+		double notional() const
+		{
+			return n;
+		}
+	};
+
+	// Fixed cash flows and a float leg.
+	template<class U = fms::sequence::list<double>, class C = fms::sequence::list<double>, class V = fms::sequence::list<double>>
+	class fixed_float : public sequence<U, C> {
+		float_leg<V> l;
+	public:
+		fixed_float(const U& u, const C& c, const float_leg<V>& leg)
+			: sequence<U, C>(u, c), l(leg)
+		{ }
+		const float_leg<V>& leg() const
+		{
+			return l;
+		}
+	};
+
+	// Overnight indexed swap receiving fixed. Compounded overnight rates projected
+	// on the discount curve telescope to 1 - D(maturity) so the swap has the same
+	// fixed cash flows as interest_rate_swap and no float leg.
+	inline auto overnight_indexed_swap(double maturity, int frequency, double coupon)
+	{
+		auto s = flows(interest_rate_swap(maturity, frequency, coupon));
+
+		return fixed_float(s.time(), s.cash(), float_leg(fms::sequence::list<double>(), 0));
+	}
+
+	// Swap receiving fixed coupons at frequency and paying float at float_frequency.
+	// Fixed coupons accrue over each period so a short last period pays less.
+	inline auto ibor_swap(double maturity, int frequency, double coupon, int float_frequency)
+	{
+		assert(maturity > 0);
+		assert(frequency > 0 and float_frequency > 0);
+
+		fms::sequence::list<double> u, c, v;
+
+		double u_ = 0;
+		for (size_t i = 1; i < schedule::count(maturity, frequency); ++i) {
+			u.push_back(double(i) / frequency);
+			c.push_back(coupon * (double(i) / frequency - u_));
+			u_ = double(i) / frequency;
+		}
+		u.push_back(maturity);
+		c.push_back(coupon * (maturity - u_));
+
+		for (size_t i = 0; i < schedule::count(maturity, float_frequency); ++i) {
+			v.push_back(double(i) / float_frequency);
+		}
+		v.push_back(maturity);
+
+		return fixed_float(u, c, float_leg(v, -1));
+	}
+
+}
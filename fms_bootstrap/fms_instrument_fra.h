@@ -5,15 +5,16 @@
 #pragma once
 
 //!!! Implement the class forward_rate_agreement in namespace fms::instrument.
+#include "fms_fixed.h"
 #include "fms_instrument_sequence.h"
 
 namespace fms::instrument {
 
 	template<class U = double, class C = double>
-	struct forward_rate_agreement : public sequence<fms::sequence::list<U>, fms::sequence::list<C>> {
+	struct forward_rate_agreement : public sequence<fixed<U, 2>, fixed<C, 2>> {
 		forward_rate_agreement(U effective, U tenor, C forward)
-			: sequence<fms::sequence::list<U>, fms::sequence::list<C>>(
-				fms::sequence::list<U>({ effective, effective + tenor }), fms::sequence::list<C>({ -1, 1 + forward * tenor })
+			: sequence<fixed<U, 2>, fixed<C, 2>>(
+				fixed<U, 2>({ effective, effective + tenor }), fixed<C, 2>({ -1, 1 + forward * tenor })
 				)
 		{ }
 	};
@@ -0,0 +1,166 @@
+// fms_instrument_schedule.h - Shared coupon time grids.
+// Every swap with the same frequency refers to the same immutable grid of
+// times i/frequency instead of storing its own copy. Grids are kept for the
+// life of the program, so code taking untrusted input bounds maturity and
+// frequency by max_maturity and max_frequency before making a swap.
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace fms::instrument {
+
+	class schedule {
+		// All grids ever made so pointers to them stay valid.
+		static std::list<std::vector<double>>& grids()
+		{
+			static std::list<std::vector<double>> g;
+
+			return g;
+		}
+		// Longest grid for each frequency.
+		static std::map<double, const std::vector<double>*>& index()
+		{
+			static std::map<double, const std::vector<double>*> i;
+
+			return i;
+		}
+		static std::mutex& mutex()
+		{
+			static std::mutex m;
+
+			return m;
+		}
+	public:
+		// Bounds for untrusted input. A grid holds maturity times frequency times.
+		static constexpr double max_maturity = 100;
+		static constexpr double max_frequency = 365;
+
+		// Pointer to at least n times i/frequency, i = 0, 1, ...
+		// The pointer is valid for the life of the program.
+		template<class T>
+		static const double* grid(const T& frequency, size_t n)
+		{
+			std::lock_guard lock(mutex());
+
+			auto& g = index()[static_cast<double>(frequency)];
+			if (!g or g->size() < n) {
+				// grow geometrically so a grid is made O(log n) times
+				size_t m = g ? std::max(n, 2 * g->size()) : std::max<size_t>(n, 64);
+				std::vector<double> t(m);
+				for (size_t i = 0; i < m; ++i) {
+					t[i] = double(i) / frequency; // same rounding as before interning
+				}
+				grids().push_back(std::move(t));
+				g = &grids().back();
+			}
+
+			return g->data();
+		}
+
+		// Number of grid times i/frequency < maturity, at least 1.
+		// Start from ceil(maturity frequency) and step to the same rounding as i/frequency.
+		template<class U, class T>
+		static size_t count(const U& maturity, const T& frequency)
+		{
+			size_t i = 1;
+
+			double m = static_cast<double>(maturity) * static_cast<double>(frequency);
+			if (m > 1) {
+				if (!(m < 0x1p52)) {
+					throw std::invalid_argument("fms::instrument::schedule::count: too many grid times");
+				}
+				i = static_cast<size_t>(std::ceil(m));
+			}
+			while (i > 1 and double(i - 1) / frequency >= maturity) {
+				--i;
+			}
+			while (double(i) / frequency < maturity) {
+				++i;
+			}
+
+			return i;
+		}
+	};
+
+	// Times 0, 1/frequency, ..., (n - 1)/frequency, maturity.
+	class schedule_time {
+		const double* g;
+		size_t i, n;
+		double m;
+	public:
+		schedule_time(const double* g, size_t n, double maturity)
+			: g(g), i(0), n(n), m(maturity)
+		{ }
+		bool operator==(const schedule_time&) const = default;
+		explicit operator bool() const
+		{
+			return i <= n;
+		}
+		double operator*() const
+		{
+			return i < n ? g[i] : m;
+		}
+		schedule_time& operator++()
+		{
+			if (i <= n) {
+				++i;
+			}
+
+			return *this;
+		}
+		const double* grid() const
+		{
+			return g;
+		}
+		// Number of grid times.
+		size_t count() const
+		{
+			return n;
+		}
+		double maturity() const
+		{
+			return m;
+		}
+	};
+
+	// Cash -1, then n - 1 coupons, then last.
+	class schedule_cash {
+		size_t i, n;
+		double c, l;
+	public:
+		schedule_cash(size_t n, double coupon, double last)
+			: i(0), n(n), c(coupon), l(last)
+		{ }
+		bool operator==(const schedule_cash&) const = default;
+		explicit operator bool() const
+		{
+			return i <= n;
+		}
+		double operator*() const
+		{
+			return i == 0 ? -1 : i < n ? c : l;
+		}
+		schedule_cash& operator++()
+		{
+			if (i <= n) {
+				++i;
+			}
+
+			return *this;
+		}
+		double coupon() const
+		{
+			return c;
+		}
+		double last() const
+		{
+			return l;
+		}
+	};
+
+}
@@ -40,4 +40,20 @@ namespace fms::instrument {
 		}
 	};
 
+	// Copy cash flows of an instrument into lists.
+	template<class U, class C>
+	inline auto flows(const sequence<U, C>& i)
+	{
+		fms::sequence::list<double> u, c;
+
+		for (auto u_ = i.time(); u_; ++u_) {
+			u.push_back(*u_);
+		}
+		for (auto c_ = i.cash(); c_; ++c_) {
+			c.push_back(*c_);
+		}
+
+		return sequence<fms::sequence::list<double>, fms::sequence::list<double>>(u, c);
+	}
+
 }
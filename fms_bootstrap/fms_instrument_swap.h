@@ -4,6 +4,10 @@
 // and 1 + coupon/frequence at maturity = n/frequency.
 // Time is measured in years. Frequency is the number of coupons per year.
 #pragma once
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include "fms_instrument_schedule.h"
 #include "fms_instrument_sequence.h"
 
 namespace fms::instrument {
@@ -12,43 +16,35 @@ namespace fms::instrument {
 	// auto make_time(....) -> (0, 1/freq,  ..., maturity)
 	// auto make_cash(....) -> (-1, c/freq, ..., 1 + c/freq)
 
-	//!!! Implement the class interest_rate_swap in namespace fms::instrument.
+	// Times refer to a grid shared by all swaps with the same frequency and cash
+	// flows are computed from the coupon so a swap does not allocate.
 	template<class U = double, class C = double, class T = int>
-	struct interest_rate_swap : public sequence<fms::sequence::list<U>, fms::sequence::list<C>> {
+	struct interest_rate_swap : public sequence<schedule_time, schedule_cash> {
 		interest_rate_swap(U maturity, T frequency, C coupon)
-			: sequence<fms::sequence::list<U>, fms::sequence::list<C>>(
+			: sequence<schedule_time, schedule_cash>(
 				make_time(maturity, frequency), make_cash(maturity, frequency, coupon)
 				)
 		{ }
 
-		auto make_time(const U& maturity, const T& frequency) {
+		static auto make_time(const U& maturity, const T& frequency) {
 			assert(maturity > 0);
 			assert(frequency > 0);
-			fms::sequence::list<double> res({ 0 });
 
-			int i;
-			for (i = 1; double(i) / frequency < maturity; i++) {
-				res.push_back(double(i) / frequency);
-			}
-			res.push_back(maturity);
-			return res;
+			size_t n = schedule::count(maturity, frequency);
+
+			return schedule_time(schedule::grid(frequency, n), n, maturity);
 		}
-		auto make_cash(const U& maturity, const T& frequency, const C& coupon) {
+		static auto make_cash(const U& maturity, const T& frequency, const C& coupon) {
 			assert(maturity > 0);
 			assert(frequency > 0);
-			fms::sequence::list<double> res({ -1 });
 
-			int i;
-			for (i = 1; double(i) / frequency < maturity; i++) {
-				res.push_back(coupon / frequency);
-			}
-			if (std::abs(double(i) / frequency - maturity) < std::numeric_limits<U>::epsilon()) {
-				res.push_back(coupon / frequency + 1);
+			size_t n = schedule::count(maturity, frequency);
+			double last = 1;
+			if (std::abs(double(n) / frequency - maturity) < std::numeric_limits<U>::epsilon()) {
+				last += coupon / frequency;
 			}
-			else {
-				res.push_back(1);
-			}
-			return res;
+
+			return schedule_cash(n, coupon / frequency, last);
 		}
-	}
+	};
 }
@@ -5,6 +5,7 @@
 #include <type_traits>
 #include <utility>
 #include "../fms_sequence/fms_sequence_traits.h"
+#include "fms_stats.h"
 
 /*
 	A piecewise flat curve is determined by points (t[i], f[i]), 0 <= i < n, and an extrapolation value _f.
@@ -68,6 +69,8 @@ namespace fms::pwflat {
 		//!!!value_type<T> t_ = 0;
 		double t_ = 0;
 
+		stats::count(stats::integral);
+
 		if (u < 0) {
 			return NaN<double>; //!!! value_type<F >> ;
 		}
@@ -113,6 +116,21 @@ namespace fms::pwflat {
 
 			return *this;
 		}
+		_F extrapolation() const
+		{
+			return _f;
+		}
+
+		// Knot times.
+		const T& time() const
+		{
+			return t;
+		}
+		// Forward values on segments ending at knot times.
+		const F& rate() const
+		{
+			return f;
+		}
 
 		_F value(const _T& u) const
 		{
@@ -132,6 +150,8 @@ namespace fms::pwflat {
 		// D(t) = exp(-int_0^t f(s) ds).
 		_F discount(const _T& u) const
 		{
+			stats::count(stats::discount);
+
 			return exp(-integral(u));
 		}
 
@@ -148,4 +168,31 @@ namespace fms::pwflat {
 		}
 	};
 
+	// Integral of a curve at non-decreasing times in one walk over the knots.
+	template<class T, class F>
+	class integral_walk {
+		T tk;
+		F fk;
+		double t_, I_, _f;
+	public:
+		integral_walk(const forward<T, F>& f)
+			: tk(f.time()), fk(f.rate()), t_(0), I_(0), _f(f.extrapolation())
+		{ }
+		double operator()(double x)
+		{
+			while (tk and *tk < x) {
+				I_ += *fk * (*tk - t_);
+				t_ = *tk;
+				++tk;
+				++fk;
+			}
+
+			if (x < 0) {
+				return NaN<double>;
+			}
+
+			return x == t_ ? I_ : I_ + (fk ? *fk : _f) * (x - t_);
+		}
+	};
+
 }
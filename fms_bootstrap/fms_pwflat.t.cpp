@@ -1,12 +1,19 @@
 // fms_pwflat.t.cpp - Test piecewise flat vector implmentation.
 #include <cassert>
+#include <cmath>
 #include "../fms_sequence/fms_sequence_list.h"
 #include "fms_pwflat.h"
+#include "fms_pwflat_plan.h"
+#include "fms_pwflat_day.h"
+#include "fms_pwflat_grid.h"
+#include "fms_pwflat_compress.h"
+#include "fms_pwflat_roll.h"
 
 using namespace fms::pwflat;
 using namespace fms::sequence;
 
 using fms::sequence::list;
+using std::isnan;
 
 fms::sequence::list<double> t({ 1, 2, 3 }), f({ .1, .2, .3 });
 
@@ -100,3 +107,238 @@ int test_pwflat_spot()
     return 0;
 }
 int test_pwflat_spot_ = test_pwflat_spot();
+
+int test_pwflat_plan()
+{
+	double u_[] = { -.5, 0, .5, 1, 1.5, 2, 2.5, 3, 3.5, 0.25 };
+	double v[10];
+	auto tf = forward(t, f);
+	plan p(t, 10, u_);
+	assert(p.layout(tf));
+	assert(!p.layout(forward(list<double>({ 1, 2 }), list<double>({ .1, .2 }))));
+
+	for (int k = 0; k < 2; ++k) {
+		if (k == 1) {
+			tf.extrapolate(0.2);
+		}
+		p.value(tf, v);
+		for (int i = 0; i < 10; ++i) {
+			assert((isnan(v[i]) and isnan(tf.value(u_[i]))) or v[i] == tf.value(u_[i]));
+		}
+		p.discount(tf, v);
+		for (int i = 0; i < 10; ++i) {
+			auto D = tf.discount(u_[i]);
+			assert((isnan(v[i]) and isnan(D)) or fabs(v[i] - D) < 1e-15);
+		}
+		p.spot(tf, v);
+		for (int i = 0; i < 10; ++i) {
+			auto r = tf.spot(u_[i]);
+			assert((isnan(v[i]) and isnan(r)) or fabs(v[i] - r) < 1e-15);
+		}
+	}
+
+	// same layout, different forwards
+	auto tg = forward(t, list<double>({ .3, .2, .1 }));
+	p.integral(tg, v);
+	for (int i = 1; i < 8; ++i) {
+		assert(fabs(v[i] - tg.integral(u_[i])) < 1e-15);
+	}
+
+	// other layouts are rejected, not read past the end of work
+	try {
+		p.value(forward(list<double>({ 1, 2, 3, 4 }), list<double>({ .1, .2, .3, .4 })), v);
+		assert(false);
+	}
+	catch (const std::invalid_argument&) {
+	}
+
+	return 0;
+}
+int test_pwflat_plan_ = test_pwflat_plan();
+
+int test_pwflat_day()
+{
+	int d[] = { 365, 730, 1095 };
+	double f_[] = { .1, .2, .3 };
+	day_forward df(3, d, f_);
+	auto tf = forward(t, f);
+
+	for (int i = -1; i <= 1200; ++i) {
+		double u = i / 365.;
+		auto v = df.value(i);
+		auto I = df.integral(i);
+		assert((isnan(v) and isnan(tf.value(u))) or v == tf.value(u));
+		assert((isnan(I) and isnan(tf.integral(u))) or fabs(I - tf.integral(u)) < 1e-14);
+		if (i > 0 and i <= 1095) {
+			assert(fabs(df.discount(i) - tf.discount(u)) < 1e-14);
+			assert(fabs(df.spot(i) - tf.spot(u)) < 1e-14);
+		}
+	}
+
+	tf.extrapolate(0.4);
+	day_forward dg(tf);
+	assert(dg.value(1096) == 0.4);
+	assert(fabs(dg.integral(1460) - tf.integral(4)) < 1e-14);
+
+	// knots less than half a day apart round to the same day
+	auto th = forward(list({ 1., 1. + 0.3 / 365, 2. }), list({ .1, .2, .3 }));
+	day_forward dh(th);
+	assert(dh.value(365) == .1);
+	assert(dh.value(366) == .3);
+	assert(dh.value(730) == .3);
+	assert(fabs(dh.integral(730) - (.1 * 1 + .3 * 1)) < 1e-14);
+
+	try {
+		int e[] = { 10, 10 };
+		day_forward de(2, e, f_);
+		assert(false);
+	}
+	catch (const std::invalid_argument&) {
+	}
+	try {
+		day_forward de(forward(list({ 1., 0.5 }), list({ .1, .2 })));
+		assert(false);
+	}
+	catch (const std::invalid_argument&) {
+	}
+
+	return 0;
+}
+int test_pwflat_day_ = test_pwflat_day();
+
+int test_pwflat_grid()
+{
+	auto tf = forward(t, f);
+	constexpr size_t n = 1000;
+	double v[n], r[n], D[n];
+
+	for (int k = 0; k < 2; ++k) {
+		if (k == 1) {
+			tf.extrapolate(0.4);
+		}
+		// daily from before 0 to past the end of the curve
+		grid(tf, -0.1, 1 / 365., n, v, r, D);
+		for (size_t j = 0; j < n; ++j) {
+			double u = -0.1 + j / 365.;
+			assert((isnan(v[j]) and isnan(tf.value(u))) or v[j] == tf.value(u));
+			assert((isnan(r[j]) and isnan(tf.spot(u))) or fabs(r[j] - tf.spot(u)) < 1e-13);
+			assert((isnan(D[j]) and isnan(tf.discount(u))) or fabs(D[j] - tf.discount(u)) < 1e-13);
+		}
+	}
+
+	// only discounts
+	grid(tf, 0, 0.5, 8, nullptr, nullptr, D);
+	assert(D[0] == 1);
+	assert(fabs(D[7] - tf.discount(3.5)) < 1e-15);
+
+	return 0;
+}
+int test_pwflat_grid_ = test_pwflat_grid();
+
+int test_pwflat_compress()
+{
+	// 1000 knots with forwards differing by a fraction of a basis point
+	const size_t n = 1000;
+	double t[n], f[n];
+	for (size_t i = 0; i < n; ++i) {
+		t[i] = 0.01 * (i + 1);
+		f[i] = 0.03 + 0.0001 * std::sin(0.1 * i) + 0.001 * (i >= 500);
+	}
+	auto F = forward(list(n, t), list(n, f));
+	F.extrapolate(0.04);
+
+	double pillar[] = { 1., 2.005, 5. };
+	double e;
+	auto G = compress(F, 3, pillar, 1e-6, &e);
+	size_t m = 0;
+	for (auto u = G.time(); u; ++u) {
+		++m;
+	}
+	assert(m < n / 10);
+	assert(e > 0 and e <= 1e-6);
+	assert(G.extrapolation() == 0.04);
+
+	// exact at pillars and last knot
+	for (double u : { 1., 2.005, 5., 10. }) {
+		assert(fabs(G.integral(u) - F.integral(u)) < 1e-14);
+	}
+
+	// discount error within reported bound
+	double e_ = 0;
+	for (size_t i = 0; i <= 20000; ++i) {
+		double u = 0.0005 * i;
+		e_ = std::max(e_, fabs(G.discount(u) - F.discount(u)));
+	}
+	assert(e_ <= e * (1 + 1e-9));
+	assert(e_ > e / 2);
+
+	// tolerance at rounding only merges equal forwards
+	auto H = compress(forward(list({ 1., 2., 3., 4. }), list({ 0.01, 0.01, 0.02, 0.02 })), 0, nullptr, 1e-15, &e);
+	assert(H.time() == list({ 2., 4. }));
+	assert(fabs(H(1.5) - 0.01) < 1e-15 and fabs(H(3.5) - 0.02) < 1e-15);
+	assert(e < 1e-15);
+
+	// repeated pillars add one knot and knots stay increasing
+	double twice[] = { 1.5, 1.5, 3., 3. };
+	auto K = compress(forward(list({ 1., 2., 3., 4. }), list({ 0.01, 0.01, 0.01, 0.01 })), 4, twice, 1e-15);
+	assert(K.time() == list({ 1.5, 3., 4. }));
+	try {
+		double down[] = { 2., 1. };
+		compress(F, 2, down, 1e-6);
+		assert(false);
+	}
+	catch (const std::invalid_argument&) {
+	}
+
+	return 0;
+}
+int test_pwflat_compress_ = test_pwflat_compress();
+
+int test_pwflat_roll()
+{
+	auto F = forward(list({ 1., 2., 5., 10. }), list({ 0.02, 0.025, 0.03, 0.035 }), 0.04);
+
+	// at 0 the curve is unchanged
+	auto G = roll(F, 0);
+	assert(G.time() == F.time() and G.rate() == F.rate());
+	assert(G.extrapolation() == F.extrapolation());
+
+	// knots at or before s are dropped
+	G = roll(F, 2);
+	assert(G.time() == list({ 3., 8. }));
+	assert(G.rate() == list({ 0.03, 0.035 }));
+
+	for (double s : { 0.5, 1.5, 4.999, 7., 12. }) {
+		G = roll(F, s);
+		double Ds = F.discount(s);
+		for (double u : { 0., 0.25, 1., 3.3, 9., 20. }) {
+			assert(G.value(u + 1e-9) == F.value(s + u + 1e-9));
+			assert(fabs(G.discount(u) - F.discount(s + u) / Ds) < 1e-14);
+		}
+	}
+
+	// past the last knot only the extrapolation is left
+	G = roll(F, 10);
+	assert(!G.time());
+	assert(G.value(1) == 0.04);
+
+	// many horizons match rolling one at a time
+	double s[] = { 0, 0.5, 1, 1, 3, 7.5, 11 };
+	auto H = roll(F, std::size(s), s);
+	assert(H.size() == std::size(s));
+	for (size_t k = 0; k < H.size(); ++k) {
+		auto Gk = roll(F, s[k]);
+		assert(H[k].time() == Gk.time() and H[k].rate() == Gk.rate());
+	}
+
+	try {
+		double t[] = { 1, 0.5 };
+		roll(F, 2, t);
+		assert(false);
+	}
+	catch (const std::invalid_argument&) {
+	}
+
+	return 0;
+}
+int test_pwflat_roll_ = test_pwflat_roll();
@@ -0,0 +1,164 @@
+// fms_pwflat_compress.h - Merge adjacent segments of piecewise flat forward curves.
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+#include "../fms_sequence/fms_sequence_list.h"
+#include "fms_pwflat.h"
+
+/*
+	Replacing the forwards on (a, b] by (I(b) - I(a))/(b - a) leaves the integral
+	unchanged at b, so it is exact at every knot of the result. Pillar times are
+	made knots so they are never merged over. On each original segment both log
+	discounts are linear, so the largest discount difference is at an end point
+	or at the one point where the derivatives of the discounts agree.
+	Each merged segment is found by galloping then bisecting over its length,
+	so a segment of k knots is checked O(log k) times.
+*/
+
+namespace fms::pwflat {
+
+	// Largest |exp(-L1(x)) - exp(-L2(x))| on [x0, x1] for linear L1 and L2
+	// with values L1, L2 at x0 and slopes s1, s2.
+	inline double discount_error(double x0, double x1, double L1, double s1, double L2, double s2)
+	{
+		const auto d = [=](double x) {
+			return fabs(exp(-(L1 + s1 * (x - x0))) - exp(-(L2 + s2 * (x - x0))));
+		};
+
+		double e = std::max(d(x0), d(x1));
+		// s1 exp(-L1(x)) = s2 exp(-L2(x)) if (L1 - L2)(x) = log(s1/s2)
+		if (s1 != s2 and s1 * s2 > 0) {
+			double x = x0 + (log(s1 / s2) - (L1 - L2)) / (s1 - s2);
+			if (x0 < x and x < x1) {
+				e = std::max(e, d(x));
+			}
+		}
+
+		return e;
+	}
+
+	// Merge adjacent segments of f keeping the integral exact at the m non-decreasing pillar
+	// times and the discount within tolerance of the original at all times. Repeated pillars
+	// and pillars at knots add no knots.
+	// Knots and forwards are written to t and g that must have room for the knots of f
+	// plus m. Pillars past the last knot are ignored. Returns the number of knots.
+	// If error is not null it is set to the largest discount difference.
+	template<class T, class F>
+	inline size_t compress(const forward<T, F>& f, size_t m, const double* pillar, double tolerance,
+		double* t, double* g, double* error = nullptr)
+	{
+		// knots of f with pillars inserted, integral at each, and if merging past is allowed
+		std::vector<double> x, I, r;
+		std::vector<bool> keep;
+		for (size_t j = 1; j < m; ++j) {
+			if (pillar[j] < pillar[j - 1]) {
+				throw std::invalid_argument("fms::pwflat::compress: pillars must be non-decreasing");
+			}
+		}
+		{
+			auto tk = f.time();
+			auto fk = f.rate();
+			double t_ = 0, I_ = 0;
+			size_t j = 0;
+			while (j < m and pillar[j] <= 0) {
+				++j;
+			}
+			for (; tk and fk; ++tk, ++fk) {
+				for (; j < m and pillar[j] < *tk; ++j) {
+					if (pillar[j] > (x.empty() ? t_ : x.back())) {
+						x.push_back(pillar[j]);
+						I.push_back(I_ + *fk * (pillar[j] - t_));
+						r.push_back(*fk);
+						keep.push_back(true);
+					}
+				}
+				I_ += *fk * (*tk - t_);
+				t_ = *tk;
+				x.push_back(t_);
+				I.push_back(I_);
+				r.push_back(*fk);
+				keep.push_back(j < m and pillar[j] == t_);
+			}
+		}
+
+		// largest discount error of one segment over (x[a-1], x[b]] with exact integral at x[b]
+		const auto span_error = [&](size_t a, size_t b) {
+			double x0 = a ? x[a - 1] : 0;
+			double I0 = a ? I[a - 1] : 0;
+			double g_ = (I[b] - I0) / (x[b] - x0);
+			double e = 0;
+			for (size_t k = a; k <= b and e <= tolerance; ++k) {
+				double xk = k ? x[k - 1] : 0;
+				double Ik = k ? I[k - 1] : 0;
+				e = std::max(e, discount_error(xk, x[k], Ik, r[k], I0 + g_ * (xk - x0), g_));
+			}
+
+			return std::pair(e, g_);
+		};
+
+		// last knot each segment can extend to
+		std::vector<size_t> limit(x.size());
+		for (size_t k = x.size(); k-- > 0; ) {
+			limit[k] = keep[k] or k + 1 == x.size() ? k : limit[k + 1];
+		}
+
+		size_t n = 0;
+		double e = 0;
+		for (size_t a = 0; a < x.size(); ) {
+			// gallop then bisect for a long segment within tolerance
+			size_t lo = a, hi = limit[a] + 1;
+			double e_ = 0;
+			for (size_t step = 1; lo < limit[a]; step *= 2) {
+				size_t b = std::min(lo + step, limit[a]);
+				auto [eb, gb] = span_error(a, b);
+				if (eb > tolerance) {
+					hi = b;
+					break;
+				}
+				lo = b;
+				e_ = eb;
+			}
+			while (lo + 1 < hi) {
+				size_t b = lo + (hi - lo) / 2;
+				auto [eb, gb] = span_error(a, b);
+				if (eb > tolerance) {
+					hi = b;
+				}
+				else {
+					lo = b;
+					e_ = eb;
+				}
+			}
+
+			t[n] = x[lo];
+			g[n] = a == lo ? r[lo] : (I[lo] - (a ? I[a - 1] : 0)) / (x[lo] - (a ? x[a - 1] : 0));
+			++n;
+			e = std::max(e, e_);
+			a = lo + 1;
+		}
+
+		if (error) {
+			*error = e;
+		}
+
+		return n;
+	}
+
+	// Compressed curve that owns its knots.
+	template<class T, class F>
+	inline auto compress(const forward<T, F>& f, size_t m, const double* pillar, double tolerance, double* error = nullptr)
+	{
+		size_t n = m;
+		for (auto t = f.time(); t; ++t) {
+			++n;
+		}
+		std::vector<double> t(n), g(n);
+
+		n = compress(f, m, pillar, tolerance, t.data(), g.data(), error);
+
+		return forward(fms::sequence::list(n, t.data()), fms::sequence::list(n, g.data()), f.extrapolation());
+	}
+
+}
@@ -0,0 +1,68 @@
+// fms_pwflat_file.cpp - Platform file mapping for fms_pwflat_file.h.
+// Kept out of the header so Windows.h is only included here.
+#include <stdexcept>
+#include <string>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "fms_pwflat_file.h"
+
+const char* fms::pwflat::file::map(const char* path, size_t& size)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	LARGE_INTEGER size_;
+	if (file == INVALID_HANDLE_VALUE or !GetFileSizeEx(file, &size_)) {
+		if (file != INVALID_HANDLE_VALUE) {
+			CloseHandle(file);
+		}
+		throw std::runtime_error(std::string("fms::pwflat::file::reader: can not open ") + path);
+	}
+	size = static_cast<size_t>(size_.QuadPart);
+	// the view keeps the mapping and file open
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void* p = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (mapping) {
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+	if (!p) {
+		throw std::runtime_error(std::string("fms::pwflat::file::reader: can not map ") + path);
+	}
+#else
+	int fd = ::open(path, O_RDONLY);
+	struct stat st;
+	if (fd < 0 or fstat(fd, &st) != 0) {
+		if (fd >= 0) {
+			::close(fd);
+		}
+		throw std::runtime_error(std::string("fms::pwflat::file::reader: can not open ") + path);
+	}
+	size = static_cast<size_t>(st.st_size);
+	void* p = size ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+	::close(fd);
+	if (p == MAP_FAILED) {
+		throw std::runtime_error(std::string("fms::pwflat::file::reader: can not map ") + path);
+	}
+#endif
+
+	return static_cast<const char*>(p);
+}
+
+void fms::pwflat::file::unmap(const char* p, size_t size)
+{
+#ifdef _WIN32
+	(void)size;
+	UnmapViewOfFile(p);
+#else
+	munmap(const_cast<char*>(p), size);
+#endif
+}
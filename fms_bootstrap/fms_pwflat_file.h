@@ -0,0 +1,353 @@
+// fms_pwflat_file.h - Binary snapshot files of piecewise flat forward curves.
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "fms_span.h"
+#include "fms_pwflat.h"
+
+/*
+	A file is a header, then curve data, then an index sorted by name and date.
+	All fields are little endian and every section is 8 byte aligned so a file
+	can be mapped into memory and queried in place without parsing or copying.
+
+	header: magic "FMSCURVE", version, count, index offset, file size
+	curve:  n times, n forwards, n integrals from 0 to each time
+	index:  count entries of name, date, n, curve offset, extrapolation
+
+	Integrals are accumulated in the same order as pwflat::integral so
+	queries on a mapped curve agree with the in-memory curve to the bit.
+
+	Mapping files from disk is platform code in fms_pwflat_file.cpp that
+	must be linked to use reader(path).
+*/
+
+namespace fms::pwflat::file {
+
+	static_assert(std::endian::native == std::endian::little, "fms::pwflat::file: little endian only");
+
+	constexpr char magic[8] = { 'F', 'M', 'S', 'C', 'U', 'R', 'V', 'E' };
+	constexpr uint32_t version = 1;
+
+	struct header {
+		char magic[8];
+		uint32_t version;
+		uint32_t count;  // number of curves
+		uint64_t index;  // offset of first entry
+		uint64_t size;   // file size in bytes
+	};
+	static_assert(sizeof(header) == 32);
+
+	struct entry {
+		char name[40];        // null terminated
+		int32_t date;         // for example yyyymmdd or a day count
+		uint32_t n;           // number of knots
+		uint64_t offset;      // offset of curve data
+		double extrapolation; // forward past last knot
+
+		std::pair<std::string_view, int32_t> key() const
+		{
+			return { std::string_view(name, strnlen(name, sizeof(name))), date };
+		}
+	};
+	static_assert(sizeof(entry) == 64);
+
+	// Curve queried in place. Lookups are binary searches using the stored integrals.
+	class curve {
+		const double* t;
+		const double* f;
+		const double* I;
+		size_t n;
+		double _f;
+
+		// index of first knot not less than u
+		size_t segment(double u) const
+		{
+			return std::lower_bound(t, t + n, u) - t;
+		}
+	public:
+		curve(size_t n = 0, const double* t = nullptr, const double* f = nullptr, const double* I = nullptr, double _f = NaN<double>)
+			: t(t), f(f), I(I), n(n), _f(_f)
+		{ }
+
+		size_t size() const
+		{
+			return n;
+		}
+		double extrapolation() const
+		{
+			return _f;
+		}
+
+		double value(double u) const
+		{
+			if (u < 0) {
+				return NaN<double>;
+			}
+
+			size_t k = segment(u);
+
+			return k < n ? f[k] : _f;
+		}
+		double integral(double u) const
+		{
+			stats::count(stats::integral);
+
+			if (u < 0) {
+				return NaN<double>;
+			}
+			if (n == 0 and u + 1 == 1) {
+				return 0;
+			}
+
+			size_t k = segment(u);
+			double t_ = k ? t[k - 1] : 0;
+			double I_ = k ? I[k - 1] : 0;
+
+			return I_ + (k < n ? f[k] : _f) * (u - t_);
+		}
+		double discount(double u) const
+		{
+			stats::count(stats::discount);
+
+			return exp(-integral(u));
+		}
+		double spot(double u) const
+		{
+			if (n == 0) {
+				return _f;
+			}
+
+			return u <= t[0] ? value(u) : -log(discount(u)) / u;
+		}
+
+		// Forward over the mapped knots.
+		auto forward() const
+		{
+			return pwflat::forward(span<double>(n, t), span<double>(n, f), _f);
+		}
+	};
+
+	// Collect curves and write them to a file.
+	class writer {
+		struct item {
+			entry e;
+			std::vector<double> data; // times, forwards, integrals
+		};
+		std::vector<item> items;
+	public:
+		template<class T, class F>
+		writer& add(const std::string& name, int32_t date, const pwflat::forward<T, F>& f)
+		{
+			item i{};
+			if (name.size() >= sizeof(i.e.name)) {
+				throw std::runtime_error("fms::pwflat::file::writer: name too long");
+			}
+			std::copy(name.begin(), name.end(), i.e.name);
+			i.e.date = date;
+			i.e.extrapolation = f.extrapolation();
+
+			std::vector<double> t, r;
+			for (auto t_ = f.time(); t_; ++t_) {
+				t.push_back(*t_);
+			}
+			for (auto r_ = f.rate(); r_ and r.size() < t.size(); ++r_) {
+				r.push_back(*r_);
+			}
+			if (r.size() != t.size()) {
+				throw std::runtime_error("fms::pwflat::file::writer: times and forwards differ in size");
+			}
+			i.e.n = static_cast<uint32_t>(t.size());
+
+			i.data = t;
+			i.data.insert(i.data.end(), r.begin(), r.end());
+			double t_ = 0, I_ = 0;
+			for (size_t k = 0; k < t.size(); ++k) {
+				I_ += r[k] * (t[k] - t_);
+				t_ = t[k];
+				i.data.push_back(I_);
+			}
+
+			items.push_back(std::move(i));
+
+			return *this;
+		}
+
+		size_t size() const
+		{
+			return items.size();
+		}
+
+		// File contents.
+		std::vector<char> bytes() const
+		{
+			std::vector<const item*> sorted;
+			for (const auto& i : items) {
+				sorted.push_back(&i);
+			}
+			std::stable_sort(sorted.begin(), sorted.end(), [](const item* a, const item* b) { return a->e.key() < b->e.key(); });
+			for (size_t k = 1; k < sorted.size(); ++k) {
+				if (sorted[k - 1]->e.key() == sorted[k]->e.key()) {
+					throw std::runtime_error("fms::pwflat::file::writer: duplicate name and date");
+				}
+			}
+
+			size_t size = sizeof(header);
+			for (const auto& i : items) {
+				size += i.data.size() * sizeof(double);
+			}
+			size_t index = size;
+			size += items.size() * sizeof(entry);
+
+			std::vector<char> b(size, 0);
+			header h{};
+			std::copy(magic, magic + 8, h.magic);
+			h.version = version;
+			h.count = static_cast<uint32_t>(items.size());
+			h.index = index;
+			h.size = size;
+			memcpy(b.data(), &h, sizeof(h));
+
+			size_t offset = sizeof(header);
+			for (size_t k = 0; k < sorted.size(); ++k) {
+				entry e = sorted[k]->e;
+				e.offset = offset;
+				const auto& d = sorted[k]->data;
+				if (!d.empty()) {
+					memcpy(b.data() + offset, d.data(), d.size() * sizeof(double));
+				}
+				offset += d.size() * sizeof(double);
+				memcpy(b.data() + index + k * sizeof(entry), &e, sizeof(e));
+			}
+
+			return b;
+		}
+
+		void write(const char* path) const
+		{
+			auto b = bytes();
+			std::ofstream os(path, std::ios::binary | std::ios::trunc);
+			if (!os.write(b.data(), b.size())) {
+				throw std::runtime_error(std::string("fms::pwflat::file::writer: can not write ") + path);
+			}
+		}
+	};
+
+	// Map a whole file read only and set its size. Throws if it can not be opened or is empty.
+	const char* map(const char* path, size_t& size);
+	void unmap(const char* p, size_t size);
+
+	// Read only view of a file in memory or mapped from disk.
+	class reader {
+		const char* p;
+		size_t size_;
+		const header* h;
+		const entry* index;
+		bool mapped = false;
+
+		void unmap()
+		{
+			if (mapped) {
+				file::unmap(p, size_);
+			}
+			mapped = false;
+		}
+		// Check header and index so queries need no further checks.
+		void validate()
+		{
+			if (size_ < sizeof(header) or reinterpret_cast<uintptr_t>(p) % alignof(double) != 0) {
+				throw std::runtime_error("fms::pwflat::file::reader: too small or misaligned");
+			}
+			h = reinterpret_cast<const header*>(p);
+			if (memcmp(h->magic, magic, sizeof(magic)) != 0) {
+				throw std::runtime_error("fms::pwflat::file::reader: not a curve file");
+			}
+			if (h->version != version) {
+				throw std::runtime_error("fms::pwflat::file::reader: unsupported version");
+			}
+			if (h->size != size_ or h->index % 8 != 0 or h->index > size_ or (size_ - h->index) / sizeof(entry) < h->count) {
+				throw std::runtime_error("fms::pwflat::file::reader: corrupt header");
+			}
+			index = reinterpret_cast<const entry*>(p + h->index);
+			for (size_t k = 0; k < h->count; ++k) {
+				const auto& e = index[k];
+				if (e.offset % 8 != 0 or e.offset > h->index or (h->index - e.offset) / (3 * sizeof(double)) < e.n) {
+					throw std::runtime_error("fms::pwflat::file::reader: corrupt index");
+				}
+				if (k and !(index[k - 1].key() < e.key())) {
+					throw std::runtime_error("fms::pwflat::file::reader: index not sorted");
+				}
+			}
+		}
+	public:
+		// View of a file already in memory. The memory must outlive the reader.
+		reader(const void* p, size_t size)
+			: p(static_cast<const char*>(p)), size_(size), h(nullptr), index(nullptr)
+		{
+			validate();
+		}
+		// Map a file read only.
+		explicit reader(const char* path)
+			: p(nullptr), size_(0), h(nullptr), index(nullptr)
+		{
+			p = map(path, size_);
+			mapped = true;
+			try {
+				validate();
+			}
+			catch (...) {
+				unmap();
+				throw;
+			}
+		}
+		reader(const reader&) = delete;
+		reader& operator=(const reader&) = delete;
+		~reader()
+		{
+			unmap();
+		}
+
+		// Number of curves.
+		size_t size() const
+		{
+			return h->count;
+		}
+		// Entries sorted by name then date.
+		const entry& operator[](size_t i) const
+		{
+			return index[i];
+		}
+		file::curve curve(const entry& e) const
+		{
+			const double* d = reinterpret_cast<const double*>(p + e.offset);
+
+			return file::curve(e.n, d, d + e.n, d + 2 * e.n, e.extrapolation);
+		}
+
+		// Entry with name and date or null if none.
+		const entry* find(std::string_view name, int32_t date) const
+		{
+			const auto key = std::pair(name, date);
+			auto e = std::lower_bound(index, index + size(), key, [](const entry& e, const auto& k) { return e.key() < k; });
+
+			return e != index + size() and e->key() == key ? e : nullptr;
+		}
+		// Entry with name and the latest date not after date or null if none.
+		const entry* latest(std::string_view name, int32_t date) const
+		{
+			const auto key = std::pair(name, date);
+			auto e = std::upper_bound(index, index + size(), key, [](const auto& k, const entry& e) { return k < e.key(); });
+
+			return e != index and (e - 1)->key().first == name ? e - 1 : nullptr;
+		}
+	};
+
+}
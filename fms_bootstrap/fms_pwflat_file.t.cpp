@@ -0,0 +1,90 @@
+// fms_pwflat_file.t.cpp - Test binary snapshot files of curves.
+#include <cassert>
+#include <cstdio>
+#include <vector>
+#include "../fms_sequence/fms_sequence_list.h"
+#include "fms_pwflat_file.h"
+
+using namespace fms::pwflat;
+using fms::sequence::list;
+
+int test_pwflat_file()
+{
+	auto F = forward(list({ 0.5, 1., 2., 5. }), list({ 0.02, 0.025, 0.03, 0.035 }));
+	auto G = forward(list({ 1., 10. }), list({ 0.01, 0.04 }), 0.05);
+	auto E = forward(list<double>(), list<double>(), 0.03);
+
+	file::writer w;
+	w.add("USD.SOFR", 20240102, F).add("EUR.ESTR", 20240102, G).add("USD.SOFR", 20240101, G).add("FLAT", 0, E);
+	assert(w.size() == 4);
+
+	const char* path = "fms_pwflat_file.t.bin";
+	w.write(path);
+	{
+		file::reader r(path);
+		assert(r.size() == 4);
+
+		// sorted by name then date
+		assert(r[0].key() == std::pair(std::string_view("EUR.ESTR"), 20240102));
+		assert(r[2].key() == std::pair(std::string_view("USD.SOFR"), 20240101));
+
+		auto e = r.find("USD.SOFR", 20240102);
+		assert(e and e->n == 4);
+		auto c = r.curve(*e);
+		for (double u : { -1., 0., 0.25, 0.5, 0.75, 1., 3., 5., 6. }) {
+			assert(c.value(u) == F.value(u) or (std::isnan(c.value(u)) and std::isnan(F.value(u))));
+			assert(c.integral(u) == F.integral(u) or (std::isnan(c.integral(u)) and std::isnan(F.integral(u))));
+		}
+		assert(c.discount(3) == F.discount(3));
+		assert(c.spot(3) == F.spot(3));
+		assert(c.forward().discount(3) == F.discount(3));
+
+		assert(!r.find("USD.SOFR", 20240103));
+		assert(r.latest("USD.SOFR", 20240103) == e);
+		assert(r.latest("USD.SOFR", 20240101)->date == 20240101);
+		assert(!r.latest("USD.SOFR", 20231231));
+		assert(!r.latest("USD", 20240103));
+
+		auto g = r.curve(*r.find("EUR.ESTR", 20240102));
+		assert(g.value(11) == 0.05);
+		assert(g.integral(11) == G.integral(11));
+
+		auto f = r.curve(*r.find("FLAT", 0));
+		assert(f.size() == 0);
+		assert(f.integral(0) == 0 and f.discount(2) == E.discount(2));
+	}
+	std::remove(path);
+
+	// in memory and corrupt files
+	auto b = w.bytes();
+	std::vector<double> a(b.size() / sizeof(double));
+	memcpy(a.data(), b.data(), b.size());
+	{
+		file::reader r(a.data(), b.size());
+		assert(r.size() == 4);
+	}
+	try {
+		file::reader r(a.data(), b.size() - 8);
+		assert(false);
+	}
+	catch (const std::runtime_error&) {
+	}
+	reinterpret_cast<char*>(a.data())[0] = 'X';
+	try {
+		file::reader r(a.data(), b.size());
+		assert(false);
+	}
+	catch (const std::runtime_error&) {
+	}
+
+	// duplicate name and date
+	try {
+		file::writer().add("A", 1, F).add("A", 1, G).bytes();
+		assert(false);
+	}
+	catch (const std::runtime_error&) {
+	}
+
+	return 0;
+}
+int test_pwflat_file_ = test_pwflat_file();
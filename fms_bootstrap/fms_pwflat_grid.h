@@ -0,0 +1,85 @@
+// fms_pwflat_grid.h - Evaluate piecewise flat forward curves on uniform time grids.
+#pragma once
+#include <cassert>
+#include <cmath>
+#include "fms_pwflat.h"
+
+/*
+	On a grid u_j = start + j*step the discount satisfies D(u + h) = D(u) exp(-f h)
+	while u and u + h are in the same segment, so one exp per segment is
+	enough. The integral and discount are recomputed from the start of the segment
+	every anchor points to bound rounding error.
+*/
+
+namespace fms::pwflat {
+
+	// Forward values v, spot rates r, and discounts D at n grid points. Any output can be null.
+	template<class T, class F>
+	inline void grid(const forward<T, F>& f, double start, double step, size_t n,
+		double* v, double* r, double* D, size_t anchor = 64)
+	{
+		assert(step > 0);
+		assert(anchor > 0);
+
+		T t = f.time();
+		F fi = f.rate();
+		const double _f = f.extrapolation();
+		const double t0 = t ? *t : NaN<double>;
+
+		double t_ = 0;  // start of segment
+		double I_ = 0;  // integral to start of segment
+		double fk = 0;  // forward on segment
+		double E = 0;   // exp(-fk step)
+		double I = 0;   // integral to u
+		double Du = 0;  // discount to u
+		size_t m = 0;   // points since last anchor
+
+		for (size_t j = 0; j < n; ++j) {
+			double u = start + j * step; // no drift in grid times
+
+			if (u < 0) {
+				if (v) v[j] = NaN<double>;
+				if (r) r[j] = f.spot(u);
+				if (D) D[j] = NaN<double>;
+				m = 0;
+
+				continue;
+			}
+
+			bool moved = false;
+			while (t and *t < u) {
+				I_ += *fi * (*t - t_);
+				t_ = *t;
+				++t;
+				++fi;
+				moved = true;
+			}
+
+			if (moved or m == 0) {
+				fk = fi ? *fi : _f;
+				E = exp(-fk * step);
+			}
+			if (moved or m == 0 or m == anchor) {
+				I = u == t_ ? I_ : I_ + fk * (u - t_);
+				Du = exp(-I);
+				m = 0;
+			}
+			else {
+				I += fk * step;
+				Du *= E;
+			}
+			++m;
+
+			if (v) {
+				v[j] = fk;
+			}
+			if (r) {
+				r[j] = std::isnan(t0) ? _f : u <= t0 ? fk : I / u;
+			}
+			if (D) {
+				D[j] = Du;
+			}
+		}
+	}
+
+}
@@ -0,0 +1,414 @@
+// fms_pwflat_history.h - Compressed daily history of piecewise flat forward curves.
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include "../fms_sequence/fms_sequence_list.h"
+#include "fms_span.h"
+#include "fms_pwflat.h"
+
+/*
+	Knot times are stored once per distinct layout and each date refers to
+	its layout. Forwards are coded against a reference: the same knot on the
+	previous date if the layout did not change, otherwise the previous knot
+	on the same date. Dates are grouped in blocks that start from no reference
+	so any date is decoded from the start of its block.
+
+	With quantum 0 forwards are lossless. The bits of each forward are xor-ed
+	with its reference and the nonzero bits are written with a leading and
+	trailing zero window as in Gorilla. Bootstrapped forwards are full
+	precision so this saves little unless forwards repeat. With quantum > 0
+	forwards are rounded to multiples of quantum and the difference of the
+	integers is written in a bit length carried between values. Each forward
+	is then within quantum/2 of the original and a small daily move takes a
+	few bits.
+
+	Extrapolations are always xor coded.
+
+	Dates can have any gaps. A date is found by binary search of the first
+	dates of blocks and a linear search of at most block dates.
+*/
+
+namespace fms::pwflat {
+
+	// Append only bit stream, least significant bit first.
+	class bit_stream {
+		std::vector<uint64_t> words;
+		size_t bits = 0;
+	public:
+		size_t size() const
+		{
+			return bits;
+		}
+		size_t bytes() const
+		{
+			return words.capacity() * sizeof(uint64_t);
+		}
+		void shrink_to_fit()
+		{
+			words.shrink_to_fit();
+		}
+
+		void put(uint64_t x, unsigned n)
+		{
+			if (n == 0) {
+				return;
+			}
+			if (n < 64) {
+				x &= (uint64_t(1) << n) - 1;
+			}
+			size_t w = bits / 64, o = bits % 64;
+			if (w == words.size()) {
+				words.push_back(0);
+			}
+			words[w] |= x << o;
+			if (o + n > 64) {
+				words.push_back(x >> (64 - o));
+			}
+			bits += n;
+		}
+		uint64_t get(size_t& pos, unsigned n) const
+		{
+			if (n == 0) {
+				return 0;
+			}
+			size_t w = pos / 64, o = pos % 64;
+			uint64_t x = words[w] >> o;
+			if (o + n > 64) {
+				x |= words[w + 1] << (64 - o);
+			}
+			if (n < 64) {
+				x &= (uint64_t(1) << n) - 1;
+			}
+			pos += n;
+
+			return x;
+		}
+	};
+
+	// Xor coding of doubles with a window of meaningful bits carried between values.
+	struct xor_code {
+		unsigned lead = 0, len = 0; // window, len 0 if none yet
+
+		void put(bit_stream& s, double v, double ref)
+		{
+			uint64_t x = std::bit_cast<uint64_t>(v) ^ std::bit_cast<uint64_t>(ref);
+			if (x == 0) {
+				s.put(0, 1);
+
+				return;
+			}
+			s.put(1, 1);
+			unsigned lz = std::min(std::countl_zero(x), 31);
+			unsigned tz = std::countr_zero(x);
+			if (len and lz >= lead and tz >= 64 - lead - len) {
+				s.put(0, 1);
+				s.put(x >> (64 - lead - len), len);
+			}
+			else {
+				lead = lz;
+				len = 64 - lz - tz;
+				s.put(1, 1);
+				s.put(lead, 5);
+				s.put(len - 1, 6);
+				s.put(x >> tz, len);
+			}
+		}
+		double get(const bit_stream& s, size_t& pos, double ref)
+		{
+			if (!s.get(pos, 1)) {
+				return ref;
+			}
+			if (s.get(pos, 1)) {
+				lead = static_cast<unsigned>(s.get(pos, 5));
+				len = static_cast<unsigned>(s.get(pos, 6)) + 1;
+			}
+			uint64_t x = s.get(pos, len) << (64 - lead - len);
+
+			return std::bit_cast<double>(std::bit_cast<uint64_t>(ref) ^ x);
+		}
+	};
+
+	// Coding of integer differences: 0 for none, else 1 then zigzag bits in
+	// the length carried from earlier values or a new 6 bit length.
+	struct delta_code {
+		unsigned len = 0; // 0 if none yet
+
+		void put(bit_stream& s, int64_t v, int64_t ref)
+		{
+			uint64_t d = static_cast<uint64_t>(v) - static_cast<uint64_t>(ref);
+			uint64_t z = (d << 1) ^ static_cast<uint64_t>(static_cast<int64_t>(d) >> 63);
+			if (z == 0) {
+				s.put(0, 1);
+
+				return;
+			}
+			s.put(1, 1);
+			unsigned n = 64 - std::countl_zero(z);
+			// keep the length unless it wastes more than a few bits
+			if (n <= len and n + 4 > len) {
+				s.put(0, 1);
+			}
+			else {
+				len = n;
+				s.put(1, 1);
+				s.put(len - 1, 6);
+			}
+			s.put(z, len);
+		}
+		int64_t get(const bit_stream& s, size_t& pos, int64_t ref)
+		{
+			if (!s.get(pos, 1)) {
+				return ref;
+			}
+			if (s.get(pos, 1)) {
+				len = static_cast<unsigned>(s.get(pos, 6)) + 1;
+			}
+			uint64_t z = s.get(pos, len);
+			uint64_t d = (z >> 1) ^ (0 - (z & 1));
+
+			return static_cast<int64_t>(static_cast<uint64_t>(ref) + d);
+		}
+	};
+
+	// Curves by increasing date, for example yyyymmdd or a day count.
+	class history {
+		double quantum;
+		size_t block;
+		std::vector<std::vector<double>> layouts;             // distinct knot times
+		std::unordered_multimap<size_t, uint32_t> layout_ids; // hash of times to layout
+		std::vector<int32_t> dates;
+		std::vector<uint32_t> layout;  // per date
+		std::vector<size_t> offset;    // bit offset of each block
+		std::vector<int32_t> first;    // first date of each block
+		bit_stream bits;
+		size_t max_knots_;
+
+		// encoder state from the last date added
+		std::vector<double> f_;
+		std::vector<int64_t> q_;
+		double e_;
+		xor_code xf, xe;
+		delta_code dq;
+
+		static size_t hash(const std::vector<double>& t)
+		{
+			size_t h = t.size();
+			for (double x : t) {
+				h ^= std::hash<double>{}(x + 0.) + 0x9e3779b9 + (h << 6) + (h >> 2);
+			}
+
+			return h;
+		}
+		uint32_t layout_id(const std::vector<double>& t)
+		{
+			if (!layout.empty() and layouts[layout.back()] == t) {
+				return layout.back();
+			}
+			size_t h = hash(t);
+			auto [b, e] = layout_ids.equal_range(h);
+			for (auto i = b; i != e; ++i) {
+				if (layouts[i->second] == t) {
+					return i->second;
+				}
+			}
+			uint32_t id = static_cast<uint32_t>(layouts.size());
+			layouts.push_back(t);
+			layout_ids.emplace(h, id);
+
+			return id;
+		}
+	public:
+		// Forwards are rounded to multiples of quantum if it is positive.
+		// Dates are decoded from the start of a block of block dates.
+		history(double quantum = 0, size_t block = 16)
+			: quantum(quantum), block(block ? block : 1), max_knots_(0), e_(0)
+		{ }
+
+		size_t size() const
+		{
+			return dates.size();
+		}
+		int32_t date(size_t k) const
+		{
+			return dates[k];
+		}
+		// Most knots of any curve. Buffers passed to load need this many.
+		size_t max_knots() const
+		{
+			return max_knots_;
+		}
+		size_t layouts_size() const
+		{
+			return layouts.size();
+		}
+
+		// Append the curve for date that must be after the last date added.
+		template<class T, class F>
+		history& add(int32_t date, const pwflat::forward<T, F>& f)
+		{
+			if (!dates.empty() and date <= dates.back()) {
+				throw std::runtime_error("fms::pwflat::history::add: dates must increase");
+			}
+			std::vector<double> t, r;
+			for (auto t_ = f.time(); t_; ++t_) {
+				t.push_back(*t_);
+			}
+			for (auto r_ = f.rate(); r_ and r.size() < t.size(); ++r_) {
+				r.push_back(*r_);
+			}
+			if (r.size() != t.size()) {
+				throw std::runtime_error("fms::pwflat::history::add: times and forwards differ in size");
+			}
+			if (quantum > 0) {
+				for (double x : r) {
+					if (!(fabs(x / quantum) < 0x1p62)) {
+						throw std::runtime_error("fms::pwflat::history::add: forward not representable with quantum");
+					}
+				}
+			}
+
+			size_t k = dates.size();
+			uint32_t id = layout_id(t);
+			bool start = k % block == 0;
+			bool same = !start and id == layout.back();
+			if (start) {
+				offset.push_back(bits.size());
+				first.push_back(date);
+				xf = xor_code{};
+				xe = xor_code{};
+				dq = delta_code{};
+				e_ = 0;
+			}
+
+			if (quantum > 0) {
+				std::vector<int64_t> q(r.size());
+				for (size_t j = 0; j < r.size(); ++j) {
+					q[j] = std::llround(r[j] / quantum);
+					dq.put(bits, q[j], same ? q_[j] : j ? q[j - 1] : 0);
+				}
+				q_ = std::move(q);
+			}
+			else {
+				for (size_t j = 0; j < r.size(); ++j) {
+					xf.put(bits, r[j], same ? f_[j] : j ? r[j - 1] : 0.);
+				}
+				f_ = r;
+			}
+			xe.put(bits, f.extrapolation(), e_);
+			e_ = f.extrapolation();
+
+			dates.push_back(date);
+			layout.push_back(id);
+			max_knots_ = std::max(max_knots_, t.size());
+
+			return *this;
+		}
+
+		// Position of date or npos if it was not added.
+		static constexpr size_t npos = static_cast<size_t>(-1);
+		size_t find(int32_t date) const
+		{
+			size_t k = latest(date);
+
+			return k != npos and dates[k] == date ? k : npos;
+		}
+		// Position of the latest date not after date or npos if none.
+		// Search the first dates of blocks, then the dates of one block.
+		size_t latest(int32_t date) const
+		{
+			if (dates.empty() or date < dates[0]) {
+				return npos;
+			}
+			size_t b = std::upper_bound(first.begin(), first.end(), date) - first.begin() - 1;
+			size_t k = b * block;
+			size_t e = std::min(k + block, dates.size());
+			while (k + 1 < e and dates[k + 1] <= date) {
+				++k;
+			}
+
+			return k;
+		}
+
+		// Decode the curve at position k into f that has room for max_knots.
+		// The returned curve refers to the stored knot times and to f.
+		auto load(size_t k, double* f) const
+		{
+			size_t b = k / block;
+			size_t pos = offset[b];
+			xor_code xf_, xe_;
+			delta_code dq_;
+			double e = 0;
+
+			for (size_t d = b * block; d <= k; ++d) {
+				size_t n = layouts[layout[d]].size();
+				bool same = d != b * block and layout[d] == layout[d - 1];
+				if (quantum > 0) {
+					// integers are kept in f as doubles until the last date
+					int64_t q = 0;
+					for (size_t j = 0; j < n; ++j) {
+						int64_t ref = same ? std::bit_cast<int64_t>(f[j]) : j ? q : 0;
+						q = dq_.get(bits, pos, ref);
+						f[j] = std::bit_cast<double>(q);
+					}
+				}
+				else {
+					for (size_t j = 0; j < n; ++j) {
+						f[j] = xf_.get(bits, pos, same ? f[j] : j ? f[j - 1] : 0.);
+					}
+				}
+				e = xe_.get(bits, pos, e);
+			}
+
+			const auto& t = layouts[layout[k]];
+			if (quantum > 0) {
+				for (size_t j = 0; j < t.size(); ++j) {
+					f[j] = std::bit_cast<int64_t>(f[j]) * quantum;
+				}
+			}
+
+			return pwflat::forward(span<double>(t.size(), t.data()), span<double>(t.size(), f), e);
+		}
+
+		// Curve at position k that owns its knots.
+		auto curve(size_t k) const
+		{
+			std::vector<double> f(max_knots_);
+			auto F = load(k, f.data());
+			const auto& t = layouts[layout[k]];
+
+			return pwflat::forward(fms::sequence::list(t.size(), t.data()), fms::sequence::list(t.size(), f.data()), F.extrapolation());
+		}
+
+		// Memory used in bytes.
+		size_t bytes() const
+		{
+			size_t n = sizeof(*this) + bits.bytes();
+			for (const auto& t : layouts) {
+				n += t.capacity() * sizeof(double);
+			}
+			n += layout_ids.size() * 2 * sizeof(size_t) + layouts.capacity() * sizeof(layouts[0]);
+			n += dates.capacity() * sizeof(int32_t) + layout.capacity() * sizeof(uint32_t);
+			n += offset.capacity() * sizeof(size_t) + first.capacity() * sizeof(int32_t);
+			n += f_.capacity() * sizeof(double) + q_.capacity() * sizeof(int64_t);
+
+			return n;
+		}
+		// Release spare capacity after the last add.
+		void shrink_to_fit()
+		{
+			bits.shrink_to_fit();
+			dates.shrink_to_fit();
+			layout.shrink_to_fit();
+			offset.shrink_to_fit();
+			first.shrink_to_fit();
+		}
+	};
+
+}
@@ -0,0 +1,174 @@
+// fms_pwflat_history.t.cpp - Test compressed curve history.
+#include <cassert>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "../fms_sequence/fms_sequence_list.h"
+#include "fms_pwflat_history.h"
+
+using namespace fms::pwflat;
+using fms::sequence::list;
+
+int test_pwflat_bit_stream()
+{
+	bit_stream s;
+	s.put(5, 3);
+	s.put(0xFFFF'FFFF'FFFF'FFFF, 64);
+	s.put(0, 1);
+	s.put(0x1234'5678'9ABC, 61);
+	assert(s.size() == 129);
+
+	size_t pos = 0;
+	assert(s.get(pos, 3) == 5);
+	assert(s.get(pos, 64) == 0xFFFF'FFFF'FFFF'FFFF);
+	assert(s.get(pos, 1) == 0);
+	assert(s.get(pos, 61) == 0x1234'5678'9ABC);
+	assert(pos == 129);
+
+	// codes round trip
+	xor_code x, y;
+	delta_code d, e;
+	double v[] = { 0.03, 0.03, 0.0301, -0.5, 0., std::nan(""), 1e300 };
+	int64_t q[] = { 0, 3, -3, 1LL << 40, -(1LL << 62), 7 };
+	bit_stream t;
+	for (size_t i = 1; i < std::size(v); ++i) {
+		x.put(t, v[i], v[i - 1]);
+	}
+	for (size_t i = 1; i < std::size(q); ++i) {
+		d.put(t, q[i], q[i - 1]);
+	}
+	pos = 0;
+	for (size_t i = 1; i < std::size(v); ++i) {
+		double w = y.get(t, pos, v[i - 1]);
+		assert(std::bit_cast<uint64_t>(w) == std::bit_cast<uint64_t>(v[i]));
+	}
+	for (size_t i = 1; i < std::size(q); ++i) {
+		assert(e.get(t, pos, q[i - 1]) == q[i]);
+	}
+	assert(pos == t.size());
+
+	return 0;
+}
+int test_pwflat_bit_stream_ = test_pwflat_bit_stream();
+
+// Daily curves from a random walk with a layout change every 50 days.
+inline auto make_days(size_t days)
+{
+	std::vector<std::pair<int32_t, forward<list<double>, list<double>>>> h;
+	std::mt19937 g(1);
+	std::normal_distribution<double> dz(0, 0.0002);
+	std::vector<double> f(40, 0.03);
+	for (size_t d = 0; d < days; ++d) {
+		size_t n = 30 + (d / 50) % 3 * 5;
+		list<double> t, r;
+		for (size_t j = 0; j < n; ++j) {
+			f[j] += dz(g);
+			t.push_back(0.5 * (j + 1) + 0.01 * ((d / 50) % 2));
+			r.push_back(j % 7 == 0 ? 0.03 : f[j]);
+		}
+		int32_t date = static_cast<int32_t>(d + 2 * (d / 5)); // weekends
+		h.emplace_back(date, forward(t, r, d % 2 ? 0.04 : std::nan("")));
+	}
+
+	return h;
+}
+
+int test_pwflat_history()
+{
+	auto days = make_days(300);
+
+	history h;
+	for (const auto& [d, f] : days) {
+		h.add(d, f);
+	}
+	assert(h.size() == days.size());
+	assert(h.max_knots() == 40);
+	assert(h.layouts_size() == 6);
+
+	// every date decodes bit for bit
+	std::vector<double> buf(h.max_knots());
+	for (size_t k = 0; k < h.size(); ++k) {
+		auto F = h.load(k, buf.data());
+		const auto& G = days[k].second;
+		auto t = F.time();
+		auto r = F.rate();
+		auto u = G.time();
+		auto s = G.rate();
+		for (; u; ++t, ++r, ++u, ++s) {
+			assert(*t == *u and *r == *s);
+		}
+		assert(!t);
+		assert(F.extrapolation() == G.extrapolation() or (std::isnan(F.extrapolation()) and std::isnan(G.extrapolation())));
+	}
+	assert(h.curve(123).discount(7) == days[123].second.discount(7));
+
+	// seek by date
+	assert(h.find(days[0].first) == 0);
+	assert(h.find(days[17].first) == 17);
+	assert(h.find(days.back().first) == days.size() - 1);
+	assert(h.find(days[5].first - 1) == history::npos); // weekend
+	assert(h.latest(days[5].first - 1) == 4);
+	assert(h.latest(days.back().first + 10) == days.size() - 1);
+	assert(h.latest(days[0].first - 1) == history::npos);
+
+	// dates as yyyymmdd with gaps do not grow the index
+	history y(0, 4);
+	int32_t ymd[] = { 19991231, 20000103, 20000104, 20000201, 20100615, 20100616, 20240101 };
+	for (size_t k = 0; k < std::size(ymd); ++k) {
+		y.add(ymd[k], days[k].second);
+	}
+	assert(y.bytes() < h.bytes());
+	for (size_t k = 0; k < std::size(ymd); ++k) {
+		assert(y.find(ymd[k]) == k);
+		assert(y.latest(ymd[k]) == k);
+	}
+	assert(y.find(20000105) == history::npos);
+	assert(y.latest(20000105) == 2);
+	assert(y.latest(20100614) == 3);
+	assert(y.latest(20100617) == 5);
+	assert(y.latest(19991230) == history::npos);
+	assert(y.latest(INT32_MAX) == std::size(ymd) - 1);
+
+	try {
+		h.add(days.back().first, days[0].second);
+		assert(false);
+	}
+	catch (const std::runtime_error&) {
+	}
+
+	return 0;
+}
+int test_pwflat_history_ = test_pwflat_history();
+
+int test_pwflat_history_quantum()
+{
+	auto days = make_days(300);
+	const double quantum = 1e-8;
+
+	history h(quantum, 8), x;
+	size_t raw = 0;
+	for (const auto& [d, f] : days) {
+		h.add(d, f);
+		x.add(d, f);
+		for (auto t = f.time(); t; ++t) {
+			raw += 2 * sizeof(double);
+		}
+	}
+	h.shrink_to_fit();
+
+	std::vector<double> buf(h.max_knots());
+	for (size_t k = 0; k < h.size(); ++k) {
+		auto F = h.load(k, buf.data());
+		auto r = F.rate();
+		for (auto s = days[k].second.rate(); s; ++r, ++s) {
+			assert(fabs(*r - *s) <= quantum / 2 * (1 + 1e-12));
+		}
+	}
+
+	// a few bits per forward
+	assert(h.bytes() * 4 < raw);
+	assert(h.bytes() < x.bytes());
+
+	return 0;
+}
+int test_pwflat_history_quantum_ = test_pwflat_history_quantum();
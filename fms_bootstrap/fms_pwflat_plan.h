@@ -0,0 +1,179 @@
+// fms_pwflat_plan.h - Precomputed knot locations for evaluating curves at fixed times.
+#pragma once
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include "fms_pwflat.h"
+
+/*
+	A plan locates each time u against knot times t[0] < ... < t[n-1] once:
+	u is in segment i if t[i-1] < u <= t[i], or i = n if u > t[n-1],
+	with offset du = u - t[i-1] where t[-1] = 0.
+
+	Any curve with the same knot times is then evaluated without searching:
+	f(u) = f[i], int_0^u f = I[i] + f[i] du, I[i] = sum_{j < i} f[j] (t[j] - t[j-1]).
+
+	Each evaluation still makes one O(n) pass over the knots of the curve to
+	check its layout and accumulate I. Only locating the m times is saved,
+	so a plan pays off when many times are evaluated on curves with few knots.
+*/
+
+namespace fms::pwflat {
+
+	class plan {
+		std::vector<double> t;  // knot times
+		std::vector<double> u;  // query times
+		std::vector<size_t> i;  // segment of u
+		std::vector<double> du; // u - t[i-1]
+
+		// Forward values and cumulative integrals at the start of each segment.
+		// Uses work if not null, otherwise allocates.
+		template<class T, class F>
+		const double* prepare(const forward<T, F>& f, double* work, std::vector<double>& w) const
+		{
+			if (!layout(f)) {
+				throw std::invalid_argument("fms::pwflat::plan: curve knot times do not match the plan");
+			}
+
+			if (!work) {
+				w.resize(work_size());
+				work = w.data();
+			}
+			double* f_ = work;
+			double* I = work + t.size() + 1;
+
+			size_t j = 0;
+			for (auto fi = f.rate(); fi and j < t.size(); ++fi) {
+				f_[j++] = *fi;
+			}
+			if (j != t.size()) {
+				throw std::invalid_argument("fms::pwflat::plan: curve has fewer rates than knots");
+			}
+			f_[j] = f.extrapolation();
+
+			double t_ = 0;
+			I[0] = 0;
+			for (j = 0; j < t.size(); ++j) {
+				I[j + 1] = I[j] + f_[j] * (t[j] - t_);
+				t_ = t[j];
+			}
+
+			return work;
+		}
+	public:
+		static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+		// Locate m times u against the knot times of tk.
+		template<class T>
+		plan(T tk, size_t m, const double* pu)
+			: u(pu, pu + m), i(m), du(m)
+		{
+			while (tk) {
+				t.push_back(*tk);
+				++tk;
+			}
+
+			size_t j = 0; // sorted times only search forward
+			for (size_t k = 0; k < m; ++k) {
+				if (u[k] < 0) {
+					i[k] = npos;
+					continue;
+				}
+				if (k == 0 or u[k] < u[k - 1]) {
+					j = 0;
+				}
+				while (j < t.size() and t[j] < u[k]) {
+					++j;
+				}
+				i[k] = j;
+				du[k] = u[k] - (j == 0 ? 0 : t[j - 1]);
+			}
+		}
+
+		size_t size() const
+		{
+			return u.size();
+		}
+		const double* time() const
+		{
+			return u.data();
+		}
+
+		// True if curve knot times match the plan.
+		template<class T, class F>
+		bool layout(const forward<T, F>& f) const
+		{
+			size_t j = 0;
+
+			for (auto tk = f.time(); tk; ++tk, ++j) {
+				if (j == t.size() or *tk != t[j]) {
+					return false;
+				}
+			}
+
+			return j == t.size();
+		}
+
+		// Size of work array for evaluation without allocating.
+		size_t work_size() const
+		{
+			return 2 * (t.size() + 1);
+		}
+
+		template<class T, class F>
+		void value(const forward<T, F>& f, double* v, double* work = nullptr) const
+		{
+			std::vector<double> w;
+			const double* f_ = prepare(f, work, w);
+
+			for (size_t k = 0; k < u.size(); ++k) {
+				v[k] = i[k] == npos ? NaN<double> : f_[i[k]];
+			}
+		}
+
+		template<class T, class F>
+		void integral(const forward<T, F>& f, double* v, double* work = nullptr) const
+		{
+			std::vector<double> w;
+			const double* f_ = prepare(f, work, w);
+			const double* I = f_ + t.size() + 1;
+
+			for (size_t k = 0; k < u.size(); ++k) {
+				// du = 0 for u = 0 so an empty curve has integral 0
+				v[k] = i[k] == npos ? NaN<double> : du[k] == 0 ? I[i[k]] : I[i[k]] + f_[i[k]] * du[k];
+			}
+		}
+
+		template<class T, class F>
+		void discount(const forward<T, F>& f, double* v, double* work = nullptr) const
+		{
+			integral(f, v, work);
+
+			for (size_t k = 0; k < u.size(); ++k) {
+				v[k] = exp(-v[k]);
+			}
+		}
+
+		template<class T, class F>
+		void spot(const forward<T, F>& f, double* v, double* work = nullptr) const
+		{
+			std::vector<double> w;
+			const double* f_ = prepare(f, work, w);
+			const double* I = f_ + t.size() + 1;
+
+			for (size_t k = 0; k < u.size(); ++k) {
+				if (i[k] == npos) {
+					v[k] = NaN<double>;
+				}
+				else if (i[k] == 0) {
+					v[k] = f_[0]; // f(u) = r(u) on [0, t0]
+				}
+				else {
+					v[k] = (I[i[k]] + f_[i[k]] * du[k]) / u[k];
+				}
+			}
+		}
+	};
+
+}
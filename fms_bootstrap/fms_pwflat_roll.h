@@ -0,0 +1,97 @@
+// fms_pwflat_roll.h - Piecewise flat forward curves seen from a later time.
+#pragma once
+#include <stdexcept>
+#include <vector>
+#include "../fms_sequence/fms_sequence_list.h"
+#include "fms_pwflat.h"
+
+/*
+	The curve rolled to s is g(u) = f(s + u), u >= 0. Its knots are t[i] - s
+	for the knots t[i] > s with the same forwards and extrapolation, so
+
+	int_0^u g = int_s^{s+u} f and g.discount(u) = f.discount(s + u)/f.discount(s).
+
+	Rolling only drops and shifts knots. It takes one pass over the knots and
+	never solves for a forward.
+*/
+
+namespace fms::pwflat {
+
+	// Knots of f rolled to s in t and r, which must have room for the knots of f.
+	// Returns the number of knots of the rolled curve.
+	template<class T, class F>
+	inline size_t roll(const forward<T, F>& f, double s, double* t, double* r)
+	{
+		if (!(s >= 0)) {
+			throw std::invalid_argument("fms::pwflat::roll: time must be non-negative");
+		}
+
+		auto ti = f.time();
+		auto fi = f.rate();
+		while (ti and *ti <= s) {
+			++ti;
+			++fi;
+		}
+
+		size_t n = 0;
+		for (; ti and fi; ++ti, ++fi, ++n) {
+			t[n] = *ti - s;
+			r[n] = *fi;
+		}
+
+		return n;
+	}
+
+	// Curve f seen from time s.
+	template<class T, class F>
+	inline auto roll(const forward<T, F>& f, double s)
+	{
+		std::vector<double> t, r;
+		for (auto ti = f.time(); ti; ++ti) {
+			t.push_back(*ti);
+		}
+		r.resize(t.size());
+
+		size_t n = roll(f, s, t.data(), r.data());
+
+		using list = fms::sequence::list<double>;
+
+		return forward<list, list>(list(n, t.data()), list(n, r.data()), f.extrapolation());
+	}
+
+	// Curves f seen from m non-decreasing times s. Knots of f are read once and
+	// each horizon starts searching where the previous one stopped.
+	template<class T, class F>
+	inline auto roll(const forward<T, F>& f, size_t m, const double* s)
+	{
+		using list = fms::sequence::list<double>;
+
+		std::vector<double> t, r;
+		auto fi = f.rate();
+		for (auto ti = f.time(); ti and fi; ++ti, ++fi) {
+			t.push_back(*ti);
+			r.push_back(*fi);
+		}
+
+		std::vector<forward<list, list>> g;
+		g.reserve(m);
+		std::vector<double> u(t.size());
+		size_t j = 0;
+		for (size_t k = 0; k < m; ++k) {
+			if (!(s[k] >= 0) or (k > 0 and s[k] < s[k - 1])) {
+				throw std::invalid_argument("fms::pwflat::roll: times must be non-negative and non-decreasing");
+			}
+			while (j < t.size() and t[j] <= s[k]) {
+				++j;
+			}
+			size_t n = t.size() - j;
+			for (size_t i = 0; i < n; ++i) {
+				u[i] = t[j + i] - s[k];
+			}
+			g.emplace_back(list(n, u.data()), list(n, r.data() + j), f.extrapolation());
+		}
+
+		return g;
+	}
+
+}
@@ -0,0 +1,108 @@
+// fms_pwflat_shared.cpp - Platform shared memory for fms_pwflat_shared.h.
+// Kept out of the header so Windows.h is only included here.
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "fms_pwflat_shared.h"
+
+void* fms::pwflat::shared::create(const char* name, size_t size, void*& handle)
+{
+#ifdef _WIN32
+	HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+		static_cast<DWORD>(uint64_t(size) >> 32), static_cast<DWORD>(size), name);
+	void* p = mapping ? MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size) : nullptr;
+	if (!p) {
+		if (mapping) {
+			CloseHandle(mapping);
+		}
+		throw std::runtime_error(std::string("fms::pwflat::shared::region: can not create ") + name);
+	}
+	handle = mapping;
+#else
+	int fd = shm_open(name, O_RDWR | O_CREAT, 0644);
+	if (fd < 0 or ftruncate(fd, static_cast<off_t>(size)) != 0) {
+		if (fd >= 0) {
+			::close(fd);
+		}
+		throw std::runtime_error(std::string("fms::pwflat::shared::region: can not create ") + name);
+	}
+	void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (p == MAP_FAILED) {
+		throw std::runtime_error(std::string("fms::pwflat::shared::region: can not map ") + name);
+	}
+	handle = nullptr;
+#endif
+
+	return p;
+}
+
+void* fms::pwflat::shared::open(const char* name, size_t& size, void*& handle)
+{
+#ifdef _WIN32
+	HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+	void* p = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	MEMORY_BASIC_INFORMATION mbi;
+	if (!p or !VirtualQuery(p, &mbi, sizeof(mbi))) {
+		if (p) {
+			UnmapViewOfFile(p);
+		}
+		if (mapping) {
+			CloseHandle(mapping);
+		}
+		throw std::runtime_error(std::string("fms::pwflat::shared::region: can not open ") + name);
+	}
+	size = mbi.RegionSize;
+	handle = mapping;
+#else
+	int fd = shm_open(name, O_RDONLY, 0);
+	struct stat st;
+	if (fd < 0 or fstat(fd, &st) != 0) {
+		if (fd >= 0) {
+			::close(fd);
+		}
+		throw std::runtime_error(std::string("fms::pwflat::shared::region: can not open ") + name);
+	}
+	size = static_cast<size_t>(st.st_size);
+	void* p = size ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+	::close(fd);
+	if (p == MAP_FAILED) {
+		throw std::runtime_error(std::string("fms::pwflat::shared::region: can not map ") + name);
+	}
+	handle = nullptr;
+#endif
+
+	return p;
+}
+
+void fms::pwflat::shared::unmap(void* p, size_t size, void* handle)
+{
+#ifdef _WIN32
+	(void)size;
+	UnmapViewOfFile(p);
+	CloseHandle(handle);
+#else
+	(void)handle;
+	munmap(p, size);
+#endif
+}
+
+void fms::pwflat::shared::remove(const char* name)
+{
+#ifdef _WIN32
+	(void)name; // removed when the last handle is closed
+#else
+	shm_unlink(name);
+#endif
+}
@@ -0,0 +1,449 @@
+// fms_pwflat_shared.h - Piecewise flat forward curves in memory shared between processes.
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "../fms_sequence/fms_sequence_list.h"
+#include "fms_pwflat.h"
+
+/*
+	A store is a header followed by a fixed number of slots, each holding one
+	named curve with room for a fixed number of knots. One process publishes
+	and any number of processes map the same memory and query it in place.
+
+	header: magic "FMSSHMEM", version, slots, capacity, slots in use, size
+	slot:   sequence number, name, n, extrapolation, then capacity times,
+	        forwards and integrals from 0 to each time
+
+	Each slot is a sequence lock. The publisher makes the sequence number odd,
+	writes the curve, and makes it even again. A reader loads an even sequence
+	number, evaluates the curve in place, and retries if the number changed.
+	Readers never write to the store so it can be mapped read only.
+	A reader spins briefly, then yields between retries. If the publisher
+	dies mid write its slot stays odd, and readers of that slot throw after
+	a timeout instead of waiting forever. Other slots stay readable.
+	Slot names are written before the slot is counted as in use and never change.
+*/
+
+namespace fms::pwflat::shared {
+
+	constexpr char magic[8] = { 'F', 'M', 'S', 'S', 'H', 'M', 'E', 'M' };
+	constexpr uint32_t version = 1;
+
+	static_assert(std::atomic<uint64_t>::is_always_lock_free, "fms::pwflat::shared: atomics must be address free");
+
+	struct header {
+		char magic[8];
+		uint32_t version;
+		uint32_t slots;              // number of slots
+		uint32_t capacity;           // knots per slot
+		std::atomic<uint32_t> count; // slots in use
+		uint64_t size;               // store size in bytes
+	};
+	static_assert(sizeof(header) == 32);
+
+	struct slot {
+		std::atomic<uint64_t> seq; // odd while being written
+		char name[40];             // null terminated
+		uint32_t n;                // number of knots
+		uint32_t reserved;
+		double extrapolation;      // forward past last knot
+	};
+	static_assert(sizeof(slot) == 64);
+
+	// Bytes needed for a store.
+	constexpr size_t bytes(size_t slots, size_t capacity)
+	{
+		return sizeof(header) + slots * (sizeof(slot) + 3 * capacity * sizeof(double));
+	}
+
+	// Relaxed loads and stores of data guarded by a sequence number.
+	inline double load(const double& x)
+	{
+		return std::atomic_ref<double>(const_cast<double&>(x)).load(std::memory_order_relaxed);
+	}
+	inline void store(double& x, double v)
+	{
+		std::atomic_ref<double>(x).store(v, std::memory_order_relaxed);
+	}
+
+	// Curve in a slot. Only meaningful inside reader::read.
+	class curve {
+		const double* t;
+		const double* f;
+		const double* I;
+		size_t n;
+		double _f;
+
+		// index of first knot not less than u
+		size_t segment(double u) const
+		{
+			return std::lower_bound(t, t + n, u, [](const double& t, double u) { return load(t) < u; }) - t;
+		}
+	public:
+		curve(size_t n = 0, const double* t = nullptr, const double* f = nullptr, const double* I = nullptr, double _f = NaN<double>)
+			: t(t), f(f), I(I), n(n), _f(_f)
+		{ }
+
+		size_t size() const
+		{
+			return n;
+		}
+		double extrapolation() const
+		{
+			return _f;
+		}
+
+		double value(double u) const
+		{
+			if (u < 0) {
+				return NaN<double>;
+			}
+
+			size_t k = segment(u);
+
+			return k < n ? load(f[k]) : _f;
+		}
+		double integral(double u) const
+		{
+			stats::count(stats::integral);
+
+			if (u < 0) {
+				return NaN<double>;
+			}
+			if (n == 0 and u + 1 == 1) {
+				return 0;
+			}
+
+			size_t k = segment(u);
+			double t_ = k ? load(t[k - 1]) : 0;
+			double I_ = k ? load(I[k - 1]) : 0;
+
+			return I_ + (k < n ? load(f[k]) : _f) * (u - t_);
+		}
+		double discount(double u) const
+		{
+			stats::count(stats::discount);
+
+			return exp(-integral(u));
+		}
+		double spot(double u) const
+		{
+			if (n == 0) {
+				return _f;
+			}
+
+			return u <= load(t[0]) ? value(u) : -log(discount(u)) / u;
+		}
+
+		// Copy that owns its knots.
+		auto forward() const
+		{
+			fms::sequence::list<double> t_, f_;
+			for (size_t k = 0; k < n; ++k) {
+				t_.push_back(load(t[k]));
+				f_.push_back(load(f[k]));
+			}
+
+			return pwflat::forward(t_, f_, _f);
+		}
+	};
+
+	// Map named shared memory. Platform code in fms_pwflat_shared.cpp that must be
+	// linked to use named regions. The handle, if any, is closed by unmap.
+	void* create(const char* name, size_t size, void*& handle);
+	void* open(const char* name, size_t& size, void*& handle);
+	void unmap(void* p, size_t size, void* handle);
+	void remove(const char* name);
+
+	// Memory holding a store. Named regions are shared between processes.
+	class region {
+		void* p;
+		size_t size_;
+		std::vector<double> local; // stand in for shared memory in one process
+		void* handle = nullptr;
+		bool mapped = false;
+	public:
+		// Private memory for tests and single process use.
+		explicit region(size_t size)
+			: p(nullptr), size_(size), local((size + sizeof(double) - 1) / sizeof(double))
+		{
+			p = local.data();
+		}
+		// Create or open the named region for writing. Names look like "/fms.curves".
+		region(const char* name, size_t size)
+			: p(nullptr), size_(size)
+		{
+			p = create(name, size, handle);
+			mapped = true;
+		}
+		// Open the named region read only.
+		explicit region(const char* name)
+			: p(nullptr), size_(0)
+		{
+			p = open(name, size_, handle);
+			mapped = true;
+		}
+		region(const region&) = delete;
+		region& operator=(const region&) = delete;
+		~region()
+		{
+			if (mapped) {
+				unmap(p, size_, handle);
+			}
+		}
+
+		void* data() const
+		{
+			return p;
+		}
+		size_t size() const
+		{
+			return size_;
+		}
+
+		// Remove the name. Processes that have it mapped keep their mapping.
+		static void remove(const char* name)
+		{
+			shared::remove(name);
+		}
+	};
+
+	// Layout of a store in memory.
+	class layout {
+	protected:
+		char* p;
+		header* h;
+
+		slot& at(size_t i) const
+		{
+			return *reinterpret_cast<slot*>(p + sizeof(header) + i * (sizeof(slot) + 3 * h->capacity * sizeof(double)));
+		}
+		double* data(size_t i) const
+		{
+			return reinterpret_cast<double*>(&at(i) + 1);
+		}
+
+		layout(void* p)
+			: p(static_cast<char*>(p)), h(static_cast<header*>(p))
+		{ }
+	public:
+		// Number of slots in use.
+		size_t size() const
+		{
+			return h->count.load(std::memory_order_acquire);
+		}
+		size_t slots() const
+		{
+			return h->slots;
+		}
+		size_t capacity() const
+		{
+			return h->capacity;
+		}
+		std::string_view name(size_t i) const
+		{
+			const slot& s = at(i);
+
+			return std::string_view(s.name, strnlen(s.name, sizeof(s.name)));
+		}
+
+		// Index of the slot with name or npos if none.
+		static constexpr size_t npos = static_cast<size_t>(-1);
+		size_t find(std::string_view name) const
+		{
+			for (size_t i = 0; i < size(); ++i) {
+				if (this->name(i) == name) {
+					return i;
+				}
+			}
+
+			return npos;
+		}
+	};
+
+	// The only process that writes to a store.
+	class publisher : public layout {
+	public:
+		// Format size bytes at p as an empty store. Readers attach after this.
+		publisher(void* p, size_t size, uint32_t slots, uint32_t capacity)
+			: layout(p)
+		{
+			if (reinterpret_cast<uintptr_t>(p) % alignof(double) != 0 or size < bytes(slots, capacity)) {
+				throw std::runtime_error("fms::pwflat::shared::publisher: too small or misaligned");
+			}
+
+			new (h) header{};
+			h->version = version;
+			h->slots = slots;
+			h->capacity = capacity;
+			h->size = bytes(slots, capacity);
+			for (size_t i = 0; i < slots; ++i) {
+				new (&at(i)) slot{};
+			}
+			// magic last so a reader never sees a partly formatted store
+			std::atomic_thread_fence(std::memory_order_release);
+			memcpy(h->magic, magic, sizeof(magic));
+		}
+
+		// Write f to the slot named name, claiming a slot if needed. Returns the slot index.
+		template<class T, class F>
+		size_t publish(std::string_view name, const pwflat::forward<T, F>& f)
+		{
+			size_t i = find(name);
+			if (i == npos) {
+				if (name.size() >= sizeof(slot::name)) {
+					throw std::runtime_error("fms::pwflat::shared::publisher: name too long");
+				}
+				i = size();
+				if (i == slots()) {
+					throw std::runtime_error("fms::pwflat::shared::publisher: no free slots");
+				}
+				std::copy(name.begin(), name.end(), at(i).name);
+			}
+
+			size_t n = 0;
+			for (auto tk = f.time(); tk; ++tk) {
+				++n;
+			}
+			if (n > capacity()) {
+				throw std::runtime_error("fms::pwflat::shared::publisher: too many knots");
+			}
+
+			slot& s = at(i);
+			double* t = data(i);
+			double* r = t + capacity();
+			double* I = r + capacity();
+
+			uint64_t seq = s.seq.load(std::memory_order_relaxed);
+			s.seq.store(seq + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+
+			n = 0;
+			double t_ = 0, I_ = 0;
+			auto tk = f.time();
+			auto fk = f.rate();
+			for (; tk and fk; ++tk, ++fk) {
+				I_ += *fk * (*tk - t_);
+				t_ = *tk;
+				store(t[n], t_);
+				store(r[n], *fk);
+				store(I[n], I_);
+				++n;
+			}
+			std::atomic_ref<uint32_t>(s.n).store(static_cast<uint32_t>(n), std::memory_order_relaxed);
+			store(s.extrapolation, f.extrapolation());
+
+			s.seq.store(seq + 2, std::memory_order_release);
+			if (i == size()) {
+				h->count.store(static_cast<uint32_t>(i + 1), std::memory_order_release);
+			}
+
+			return i;
+		}
+	};
+
+	// Queries a store published by another process.
+	class reader : public layout {
+		std::chrono::nanoseconds timeout_ = std::chrono::seconds(1);
+	public:
+		reader(const void* p, size_t size)
+			: layout(const_cast<void*>(p))
+		{
+			if (size < sizeof(header) or reinterpret_cast<uintptr_t>(p) % alignof(double) != 0) {
+				throw std::runtime_error("fms::pwflat::shared::reader: too small or misaligned");
+			}
+			if (memcmp(h->magic, magic, sizeof(magic)) != 0) {
+				throw std::runtime_error("fms::pwflat::shared::reader: not a curve store");
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (h->version != version) {
+				throw std::runtime_error("fms::pwflat::shared::reader: unsupported version");
+			}
+			if (h->size != bytes(h->slots, h->capacity) or h->size > size) {
+				throw std::runtime_error("fms::pwflat::shared::reader: corrupt header");
+			}
+		}
+
+		// Sequence number of slot i. Changes each time it is published.
+		uint64_t sequence(size_t i) const
+		{
+			return at(i).seq.load(std::memory_order_acquire);
+		}
+
+		// Longest a read waits for a consistent view before throwing.
+		void timeout(std::chrono::nanoseconds t)
+		{
+			timeout_ = t;
+		}
+
+		// Call op(curve) on a consistent view of slot i and return its result.
+		// The op may be called more than once if the publisher writes concurrently
+		// so it should not have side effects. Throws if no consistent view is seen
+		// within the timeout, for example if the publisher died while writing slot i.
+		template<class Op>
+		auto read(size_t i, Op op) const
+		{
+			const slot& s = at(i);
+			const double* t = data(i);
+
+			constexpr unsigned spins = 64; // retries before yielding
+			std::chrono::steady_clock::time_point t0;
+			for (unsigned k = 0; ; ++k) {
+				uint64_t seq = s.seq.load(std::memory_order_acquire);
+				if (seq % 2 == 0) {
+					// n is clamped so a torn read never leaves the slot
+					size_t n = std::min<size_t>(std::atomic_ref<uint32_t>(const_cast<uint32_t&>(s.n)).load(std::memory_order_relaxed), capacity());
+					auto result = op(curve(n, t, t + capacity(), t + 2 * capacity(), load(s.extrapolation)));
+					std::atomic_thread_fence(std::memory_order_acquire);
+					if (s.seq.load(std::memory_order_relaxed) == seq) {
+						return result;
+					}
+				}
+				if (k >= spins) {
+					auto now = std::chrono::steady_clock::now();
+					if (k == spins) {
+						t0 = now;
+					}
+					else if (now - t0 > timeout_) {
+						throw std::runtime_error("fms::pwflat::shared::reader: slot is being written too long, publisher may have died");
+					}
+					std::this_thread::yield();
+				}
+			}
+		}
+
+		double value(size_t i, double u) const
+		{
+			return read(i, [u](const curve& c) { return c.value(u); });
+		}
+		double integral(size_t i, double u) const
+		{
+			return read(i, [u](const curve& c) { return c.integral(u); });
+		}
+		double discount(size_t i, double u) const
+		{
+			return read(i, [u](const curve& c) { return c.discount(u); });
+		}
+		double spot(size_t i, double u) const
+		{
+			return read(i, [u](const curve& c) { return c.spot(u); });
+		}
+
+		// Copy of slot i that owns its knots.
+		auto forward(size_t i) const
+		{
+			return read(i, [](const curve& c) { return c.forward(); });
+		}
+	};
+
+}
@@ -0,0 +1,175 @@
+// fms_pwflat_shared.t.cpp - Test curves in shared memory.
+#include <cassert>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "../fms_sequence/fms_sequence_list.h"
+#include "fms_pwflat_shared.h"
+
+using namespace fms::pwflat;
+using fms::sequence::list;
+
+int test_pwflat_shared()
+{
+	auto F = forward(list({ 0.5, 1., 2., 5. }), list({ 0.02, 0.025, 0.03, 0.035 }));
+	auto G = forward(list({ 1., 10. }), list({ 0.01, 0.04 }), 0.05);
+	auto E = forward(list<double>(), list<double>(), 0.03);
+
+	shared::region m(shared::bytes(3, 4));
+	shared::publisher w(m.data(), m.size(), 3, 4);
+	shared::reader r(m.data(), m.size());
+	assert(r.size() == 0 and r.slots() == 3 and r.capacity() == 4);
+	assert(r.find("USD.SOFR") == shared::reader::npos);
+
+	size_t i = w.publish("USD.SOFR", F);
+	size_t j = w.publish("EUR.ESTR", G);
+	assert(i == 0 and j == 1);
+	assert(r.size() == 2);
+	assert(r.find("USD.SOFR") == i and r.find("EUR.ESTR") == j);
+	assert(r.name(j) == "EUR.ESTR");
+
+	// bit for bit the same as the published curve
+	for (double u : { 0., 0.25, 0.5, 0.75, 1., 3., 5., 6. }) {
+		assert(r.value(i, u) == F.value(u) or (std::isnan(r.value(i, u)) and std::isnan(F.value(u))));
+		assert(r.integral(i, u) == F.integral(u) or (std::isnan(r.integral(i, u)) and std::isnan(F.integral(u))));
+	}
+	assert(std::isnan(r.value(i, -1)));
+	assert(r.discount(i, 3) == F.discount(3));
+	assert(r.spot(i, 3) == F.spot(3));
+	assert(r.value(j, 11) == 0.05);
+	assert(r.integral(j, 11) == G.integral(11));
+	assert(r.forward(j).discount(11) == G.discount(11));
+
+	// republishing reuses the slot and changes its sequence number
+	uint64_t s = r.sequence(i);
+	assert(s % 2 == 0);
+	assert(w.publish("USD.SOFR", G) == i);
+	assert(r.sequence(i) == s + 2);
+	assert(r.discount(i, 3) == G.discount(3));
+	assert(r.size() == 2);
+
+	w.publish("FLAT", E);
+	assert(r.integral(2, 0) == 0 and r.discount(2, 2) == E.discount(2));
+
+	// no free slots, too many knots, name too long
+	try {
+		w.publish("GBP.SONIA", E);
+		assert(false);
+	}
+	catch (const std::runtime_error&) {
+	}
+	try {
+		w.publish("FLAT", forward(list({ 1., 2., 3., 4., 5. }), list({ 0.01, 0.01, 0.01, 0.01, 0.01 })));
+		assert(false);
+	}
+	catch (const std::runtime_error&) {
+	}
+	assert(r.discount(2, 2) == E.discount(2));
+
+	// a publisher that dies mid write leaves the slot odd and readers time out
+	{
+		auto& seq = reinterpret_cast<shared::slot*>(static_cast<char*>(m.data()) + sizeof(shared::header))->seq;
+		assert(r.sequence(0) == seq);
+		++seq;
+		r.timeout(std::chrono::milliseconds(10));
+		try {
+			r.value(0, 1);
+			assert(false);
+		}
+		catch (const std::runtime_error&) {
+		}
+		assert(r.value(1, 1) == G.value(1));
+		++seq;
+		assert(r.discount(0, 3) == G.discount(3));
+	}
+
+	try {
+		shared::publisher(m.data(), m.size(), 3, 5);
+		assert(false);
+	}
+	catch (const std::runtime_error&) {
+	}
+
+	// not a store
+	std::vector<double> z(8);
+	try {
+		shared::reader(z.data(), z.size() * sizeof(double));
+		assert(false);
+	}
+	catch (const std::runtime_error&) {
+	}
+
+	return 0;
+}
+int test_pwflat_shared_ = test_pwflat_shared();
+
+// Readers always see one of the published curves while the publisher writes.
+int test_pwflat_shared_concurrent()
+{
+	shared::region m(shared::bytes(1, 100));
+	shared::publisher w(m.data(), m.size(), 1, 100);
+
+	// flat curves so a consistent read has discount exp(-f u) for some published f
+	auto flat = [](size_t n, double f) {
+		list<double> t, r;
+		for (size_t k = 1; k <= n; ++k) {
+			t.push_back(0.3 * k);
+			r.push_back(f);
+		}
+		return forward(t, r, f);
+	};
+	w.publish("C", flat(100, 0.01));
+
+	std::atomic<bool> done = false;
+	std::atomic<size_t> bad = 0;
+	std::vector<std::thread> readers;
+	for (int k = 0; k < 4; ++k) {
+		readers.emplace_back([&]() {
+			shared::reader r(m.data(), m.size());
+			size_t i = r.find("C");
+			while (!done) {
+				double x = r.read(i, [](const shared::curve& c) { return c.value(1) - c.value(29); });
+				if (x != 0) {
+					++bad;
+				}
+			}
+		});
+	}
+	for (int k = 1; k < 2'000; ++k) {
+		w.publish("C", flat(50 + k % 51, 0.01 + 0.0001 * k));
+	}
+	done = true;
+	for (auto& t : readers) {
+		t.join();
+	}
+	assert(bad == 0);
+
+	return 0;
+}
+int test_pwflat_shared_concurrent_ = test_pwflat_shared_concurrent();
+
+#ifndef _WIN32
+// Named region opened by another mapping as a worker process would.
+int test_pwflat_shared_named()
+{
+	const char* name = "/fms_pwflat_shared.t";
+	try {
+		shared::region m(name, shared::bytes(2, 8));
+		shared::publisher w(m.data(), m.size(), 2, 8);
+		auto F = forward(list({ 1., 2. }), list({ 0.02, 0.03 }));
+		w.publish("USD.SOFR", F);
+
+		shared::region o(name);
+		shared::reader r(o.data(), o.size());
+		assert(r.discount(r.find("USD.SOFR"), 1.5) == F.discount(1.5));
+	}
+	catch (const std::runtime_error&) {
+		// no shared memory in this environment
+	}
+	shared::region::remove(name);
+
+	return 0;
+}
+int test_pwflat_shared_named_ = test_pwflat_shared_named();
+#endif
@@ -0,0 +1,262 @@
+// fms_rcu.h - Publish immutable values to concurrent readers without locks.
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/*
+	Readers enter a critical section with a guard and load the current pointer.
+	Writers publish a new value with an atomic exchange and retire the old one.
+	Reclamation is epoch based: a retired value is tagged with the global epoch
+	at the time it was unlinked and deleted once every reader in a critical
+	section entered after that epoch. Reading is wait free: a load, a store
+	to the thread's own record, and a load of the pointer.
+*/
+
+namespace fms::rcu {
+
+	// Per thread reader state. Records are reused by later threads and shared
+	// with the owning thread so either can go away first.
+	struct record {
+		std::atomic<uint64_t> epoch = 0; // 0 if not reading
+		std::atomic<bool> used = false;
+		unsigned depth = 0;              // nested guards, owner thread only
+	};
+
+	class domain {
+		const uint64_t id; // unique so thread caches never see a reused address
+		std::atomic<uint64_t> epoch_ = 1;
+		std::mutex mutex; // records and retired list
+		std::list<std::shared_ptr<record>> records;
+		struct retired {
+			uint64_t epoch;
+			const void* p;
+			void (*del)(const void*);
+		};
+		std::vector<retired> garbage;
+
+		// smallest epoch of an active reader, or UINT64_MAX
+		uint64_t oldest()
+		{
+			uint64_t e = UINT64_MAX;
+			for (auto& r : records) {
+				uint64_t re = r->epoch.load();
+				if (re != 0 and re < e) {
+					e = re;
+				}
+			}
+
+			return e;
+		}
+		static std::atomic<uint64_t>& next_id()
+		{
+			static std::atomic<uint64_t> i = 1;
+
+			return i;
+		}
+	public:
+		domain()
+			: id(next_id()++)
+		{ }
+		domain(const domain&) = delete;
+		domain& operator=(const domain&) = delete;
+		~domain()
+		{
+			for (auto& g : garbage) {
+				g.del(g.p);
+			}
+		}
+
+		uint64_t epoch() const
+		{
+			return epoch_.load();
+		}
+
+		// Record for the calling thread.
+		record& local()
+		{
+			struct owner {
+				std::shared_ptr<record> r;
+				~owner()
+				{
+					if (r) {
+						r->used.store(false, std::memory_order_release);
+					}
+				}
+			};
+			thread_local std::unordered_map<uint64_t, owner> owners;
+			thread_local std::pair<uint64_t, record*> last = { 0, nullptr };
+
+			if (last.first == id) {
+				return *last.second;
+			}
+
+			auto& o = owners[id];
+			if (!o.r) {
+				std::lock_guard lock(mutex);
+				for (auto& r : records) {
+					bool f = false;
+					if (r->used.compare_exchange_strong(f, true)) {
+						o.r = r;
+						break;
+					}
+				}
+				if (!o.r) {
+					o.r = records.emplace_back(std::make_shared<record>());
+					o.r->used = true;
+				}
+			}
+			last = { id, o.r.get() };
+
+			return *o.r;
+		}
+
+		// Delete p with del once no reader can hold it. Call after p is unlinked.
+		void retire(const void* p, void (*del)(const void*))
+		{
+			if (!p) {
+				return;
+			}
+
+			std::lock_guard lock(mutex);
+			garbage.push_back(retired{ epoch_.fetch_add(1), p, del });
+		}
+		template<class T>
+		void retire(const T* p)
+		{
+			retire(p, [](const void* p) { delete static_cast<const T*>(p); });
+		}
+
+		// Delete retired values no reader can hold. Returns the number still pending.
+		size_t reclaim()
+		{
+			std::vector<retired> free;
+			{
+				std::lock_guard lock(mutex);
+
+				uint64_t e = oldest();
+				auto i = std::partition(garbage.begin(), garbage.end(), [e](const retired& r) { return r.epoch >= e; });
+				free.assign(i, garbage.end());
+				garbage.erase(i, garbage.end());
+			}
+			// deleters run outside the lock
+			for (auto& r : free) {
+				r.del(r.p);
+			}
+
+			std::lock_guard lock(mutex);
+
+			return garbage.size();
+		}
+
+		// Wait until every value retired so far is deleted.
+		void synchronize()
+		{
+			while (reclaim() != 0) {
+				std::this_thread::yield();
+			}
+		}
+
+		// Process wide domain.
+		static domain& global()
+		{
+			static domain d;
+
+			return d;
+		}
+	};
+
+	// Reader critical section. Pointers loaded under a guard stay valid until it is destroyed.
+	class guard {
+		record& r;
+	public:
+		guard(domain& d = domain::global())
+			: r(d.local())
+		{
+			if (r.depth++ == 0) {
+				r.epoch.store(d.epoch());
+			}
+		}
+		guard(const guard&) = delete;
+		guard& operator=(const guard&) = delete;
+		~guard()
+		{
+			if (--r.depth == 0) {
+				r.epoch.store(0, std::memory_order_release);
+			}
+		}
+	};
+
+	// Atomic pointer to an immutable value.
+	template<class T>
+	class cell {
+		std::atomic<const T*> p;
+		domain& d;
+	public:
+		cell(std::unique_ptr<const T> t = nullptr, domain& d = domain::global())
+			: p(t.release()), d(d)
+		{ }
+		cell(const cell&) = delete;
+		cell& operator=(const cell&) = delete;
+		~cell()
+		{
+			d.retire(p.exchange(nullptr));
+		}
+
+		// Current value, valid while the guard is alive. Null if nothing was published.
+		const T* get(const guard&) const
+		{
+			return p.load();
+		}
+
+		// Make t the current value and retire the previous one.
+		void publish(std::unique_ptr<const T> t)
+		{
+			d.retire(p.exchange(t.release()));
+			d.reclaim();
+		}
+	};
+
+	// Cells by name. Look a cell up once then read it without locks.
+	template<class T>
+	class registry {
+		std::mutex mutex;
+		std::unordered_map<std::string, std::unique_ptr<cell<T>>> cells;
+		domain& d;
+	public:
+		registry(domain& d = domain::global())
+			: d(d)
+		{ }
+
+		// Cell for name, created empty if needed. The reference is valid for the life of the registry.
+		cell<T>& operator[](const std::string& name)
+		{
+			std::lock_guard lock(mutex);
+
+			auto& c = cells[name];
+			if (!c) {
+				c = std::make_unique<cell<T>>(nullptr, d);
+			}
+
+			return *c;
+		}
+		void publish(const std::string& name, std::unique_ptr<const T> t)
+		{
+			(*this)[name].publish(std::move(t));
+		}
+		size_t size()
+		{
+			std::lock_guard lock(mutex);
+
+			return cells.size();
+		}
+	};
+
+}
@@ -0,0 +1,104 @@
+// fms_rcu.t.cpp - Test publication of immutable values to concurrent readers.
+#include <cassert>
+#include <thread>
+#include <vector>
+#include "fms_rcu.h"
+#include "fms_pwflat.h"
+#include "../fms_sequence/fms_sequence_list.h"
+
+using namespace fms::rcu;
+
+// Value that checks it is never read after it is deleted.
+struct checked {
+	static inline std::atomic<int> live = 0;
+	int a, b;
+	checked(int i)
+		: a(i), b(-i)
+	{
+		++live;
+	}
+	~checked()
+	{
+		a = b = 1; // torn if read after delete
+		--live;
+	}
+};
+
+int test_rcu()
+{
+	domain d;
+	{
+		cell<checked> c(std::make_unique<const checked>(0), d);
+		assert(checked::live == 1);
+
+		// a reader holds the old value across a publish
+		{
+			guard g(d);
+			const checked* p = c.get(g);
+			c.publish(std::make_unique<const checked>(1));
+			assert(checked::live == 2);
+			assert(p->a == 0 and p->b == 0);
+			assert(c.get(g)->a == 1);
+			{
+				guard h(d); // nested
+			}
+			assert(d.reclaim() == 1);
+		}
+		assert(d.reclaim() == 0);
+		assert(checked::live == 1);
+
+		// concurrent readers while publishing
+		std::atomic<bool> done = false;
+		std::vector<std::thread> readers;
+		std::atomic<long> reads = 0;
+		std::atomic<int> started = 0;
+		for (int i = 0; i < 4; ++i) {
+			readers.emplace_back([&]() {
+				long n = 0;
+				while (!done) {
+					guard g(d);
+					const checked* p = c.get(g);
+					assert(p->a == -p->b);
+					if (n++ == 0) {
+						++started;
+					}
+				}
+				reads += n;
+			});
+		}
+		while (started < 4) {
+			std::this_thread::yield();
+		}
+		for (int i = 2; i < 1000; ++i) {
+			c.publish(std::make_unique<const checked>(i));
+		}
+		done = true;
+		for (auto& r : readers) {
+			r.join();
+		}
+		d.synchronize();
+		assert(checked::live == 1);
+		assert(reads > 0);
+	}
+	d.synchronize();
+	assert(checked::live == 0);
+
+	// registry of curves
+	using forward = fms::pwflat::forward<fms::sequence::list<double>, fms::sequence::list<double>>;
+	registry<forward> r(d);
+	auto& usd = r["USD"];
+	{
+		guard g(d);
+		assert(!usd.get(g));
+	}
+	r.publish("USD", std::make_unique<const forward>(fms::sequence::list({ 1. }), fms::sequence::list({ 0.03 })));
+	{
+		guard g(d);
+		assert(usd.get(g)->value(0.5) == 0.03);
+	}
+	assert(&r["USD"] == &usd);
+	assert(r.size() == 1);
+
+	return 0;
+}
+int test_rcu_ = test_rcu();
@@ -0,0 +1,80 @@
+// fms_reduce.h - Sums that give the same bits for any thread count and vector width.
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+
+/*
+	Floating point addition is not associative so a sum depends on its order.
+	Here the order depends only on the number of terms. A block of at most
+	block terms is summed in lanes independent accumulators, term i going to
+	lane i % lanes, and the lanes are added pairwise. Longer sums split at a
+	multiple of block near the middle and add the two halves. Vectorizing
+	the lane loop does not change the order of any lane, and the parallel sum
+	evaluates the same tree with subtrees on different threads.
+	Pairwise summation also has error growing like log n instead of n.
+*/
+
+namespace fms::reduce {
+
+	constexpr size_t lanes = 8;
+	constexpr size_t block = 128;
+
+	// Sum of at most block terms.
+	inline double block_sum(size_t n, const double* x)
+	{
+		double a[lanes] = {};
+
+		size_t i = 0;
+		for (; i + lanes <= n; i += lanes) {
+			for (size_t j = 0; j < lanes; ++j) {
+				a[j] += x[i + j];
+			}
+		}
+		for (size_t j = 0; j < lanes and i + j < n; ++j) {
+			a[j] += x[i + j];
+		}
+
+		return ((a[0] + a[1]) + (a[2] + a[3])) + ((a[4] + a[5]) + (a[6] + a[7]));
+	}
+
+	// Where a sum of n > block terms splits.
+	inline size_t split(size_t n)
+	{
+		return (n / 2 + block - 1) / block * block;
+	}
+
+	// Sum of x[0], ..., x[n-1] in an order fixed by n.
+	inline double sum(size_t n, const double* x)
+	{
+		if (n <= block) {
+			return block_sum(n, x);
+		}
+
+		size_t h = split(n);
+
+		return sum(h, x) + sum(n - h, x + h);
+	}
+
+	// Same bits as sum using up to threads threads, 0 for all cores.
+	inline double sum(size_t n, const double* x, unsigned threads)
+	{
+		constexpr size_t grain = 64 * block; // not worth a thread below this
+
+		if (threads == 0) {
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		}
+		if (threads == 1 or n <= grain) {
+			return sum(n, x);
+		}
+
+		size_t h = split(n);
+		double left;
+		std::thread t([&left, h, x, threads]() { left = sum(h, x, threads / 2); });
+		double right = sum(n - h, x + h, threads - threads / 2);
+		t.join();
+
+		return left + right;
+	}
+
+}
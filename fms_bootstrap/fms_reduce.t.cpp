@@ -0,0 +1,63 @@
+// fms_reduce.t.cpp - Test sums that do not depend on thread count.
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "fms_reduce.h"
+
+using namespace fms;
+
+inline bool same(double x, double y)
+{
+	return std::memcmp(&x, &y, sizeof(double)) == 0;
+}
+
+int test_reduce_sum()
+{
+	assert(reduce::sum(0, nullptr) == 0);
+
+	// exact for small integers at every length
+	std::vector<double> x(1000);
+	for (size_t n = 0; n < x.size(); ++n) {
+		x[n] = double(n + 1);
+		assert(reduce::sum(n + 1, x.data()) == (n + 1) * (n + 2) / 2);
+	}
+
+	// split points are multiples of block
+	for (size_t n : { reduce::block + 1, size_t(1000), size_t(12345) }) {
+		size_t h = reduce::split(n);
+		assert(h % reduce::block == 0 and h < n and 2 * h >= n);
+	}
+
+	return 0;
+}
+int test_reduce_sum_ = test_reduce_sum();
+
+int test_reduce_threads()
+{
+	std::mt19937 g(1);
+	std::uniform_real_distribution<double> u(-1, 1);
+	for (size_t n : { 100, 10'000, 100'000, 1'000'003 }) {
+		std::vector<double> x(n);
+		for (auto& xi : x) {
+			xi = u(g) * exp(20 * u(g));
+		}
+		double s = reduce::sum(n, x.data());
+		for (unsigned threads : { 1, 2, 3, 5, 8 }) {
+			assert(same(s, reduce::sum(n, x.data(), threads)));
+		}
+	}
+
+	// error grows slower than the naive loop
+	std::vector<double> x(1'000'000, 0.1);
+	double naive = 0;
+	for (double xi : x) {
+		naive += xi;
+	}
+	double s = reduce::sum(x.size(), x.data());
+	assert(fabs(s - 100'000) < fabs(naive - 100'000) / 100);
+
+	return 0;
+}
+int test_reduce_threads_ = test_reduce_threads();
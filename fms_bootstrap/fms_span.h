@@ -0,0 +1,44 @@
+// fms_span.h - Sequence over contiguous memory that does not own it.
+// Copying a span copies a pointer and a count so it never allocates.
+#pragma once
+#include <cstddef>
+
+namespace fms {
+
+	template<class T>
+	class span {
+		const T* p;
+		size_t n;
+	public:
+		span(size_t n = 0, const T* p = nullptr)
+			: p(p), n(n)
+		{ }
+		bool operator==(const span&) const = default;
+		explicit operator bool() const
+		{
+			return n != 0;
+		}
+		const T& operator*() const
+		{
+			return *p;
+		}
+		span& operator++()
+		{
+			if (n) {
+				++p;
+				--n;
+			}
+
+			return *this;
+		}
+		size_t size() const
+		{
+			return n;
+		}
+		const T* data() const
+		{
+			return p;
+		}
+	};
+
+}
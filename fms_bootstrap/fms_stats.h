@@ -0,0 +1,226 @@
+// fms_stats.h - Call counts and timing histograms for curves and bootstrapping.
+// Define FMS_STATS=1 to collect statistics. Otherwise all calls compile to nothing.
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifndef FMS_STATS
+#define FMS_STATS 0
+#endif
+
+namespace fms::stats {
+
+	constexpr bool enabled = FMS_STATS != 0;
+
+	enum counter {
+		discount,    // forward::discount calls
+		integral,    // pwflat::integral calls
+		pv,          // bootstrap::pv calls
+		extend,      // bootstrap::extend calls
+		iterations,  // secant iterations in extend
+		closed_form, // extend calls solved without iteration
+		fit,         // bootstrap::fit calls
+		fit_iterations, // Gauss-Newton iterations in fit
+		counters
+	};
+
+	enum timer {
+		extend_ns,   // nanoseconds per bootstrap::extend
+		curve_ns,    // nanoseconds per bootstrap::curve
+		fit_ns,      // nanoseconds per bootstrap::fit
+		timers
+	};
+
+	// Histogram bucket i counts values in [2^(i-1), 2^i), bucket 0 counts 0.
+	constexpr size_t buckets = 48;
+
+	inline size_t bucket(uint64_t x)
+	{
+		size_t i = 0;
+
+		while (x and i + 1 < buckets) {
+			x >>= 1;
+			++i;
+		}
+
+		return i;
+	}
+
+	// Statistics for one thread. Only the owning thread writes so relaxed
+	// load and store are enough and there is no contention between threads.
+	struct block {
+		std::atomic<uint64_t> count[counters] = {};
+		std::atomic<uint64_t> time[timers][buckets] = {};
+		std::atomic<uint64_t> secant[buckets] = {}; // histogram of iterations per extend
+		std::atomic<double> residual = 0;           // largest absolute residual after extend
+
+		static void incr(std::atomic<uint64_t>& a, uint64_t n = 1)
+		{
+			a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+		}
+	};
+
+	// All blocks ever used. Blocks outlive their threads so counts are not lost.
+	inline std::mutex& registry_mutex()
+	{
+		static std::mutex m;
+
+		return m;
+	}
+	inline std::vector<std::shared_ptr<block>>& registry()
+	{
+		static std::vector<std::shared_ptr<block>> r;
+
+		return r;
+	}
+	inline block& local()
+	{
+		thread_local std::shared_ptr<block> b = [] {
+			auto b_ = std::make_shared<block>();
+			std::lock_guard lock(registry_mutex());
+			registry().push_back(b_);
+
+			return b_;
+		}();
+
+		return *b;
+	}
+
+	inline void count(counter c, uint64_t n = 1)
+	{
+		if constexpr (enabled) {
+			block::incr(local().count[c], n);
+		}
+	}
+
+	// Record result of solving one segment.
+	inline void segment(int iter, double residual)
+	{
+		if constexpr (enabled) {
+			auto& b = local();
+			block::incr(b.count[extend]);
+			block::incr(b.count[iterations], iter);
+			if (iter == 0) {
+				block::incr(b.count[closed_form]);
+			}
+			block::incr(b.secant[bucket(iter)]);
+			if (fabs(residual) > b.residual.load(std::memory_order_relaxed)) {
+				b.residual.store(fabs(residual), std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// Add elapsed time of scope to a histogram.
+	template<bool E = enabled>
+	class scope {
+		timer t;
+		std::chrono::steady_clock::time_point t0;
+		bool record = true;
+	public:
+		scope(timer t)
+			: t(t), t0(std::chrono::steady_clock::now())
+		{ }
+		scope(const scope&) = delete;
+		scope& operator=(const scope&) = delete;
+		~scope()
+		{
+			if (record) {
+				auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+				block::incr(local().time[t][bucket(static_cast<uint64_t>(ns))]);
+			}
+		}
+		// Do not record, e.g. for work abandoned part way.
+		void discard()
+		{
+			record = false;
+		}
+	};
+	template<>
+	class scope<false> {
+	public:
+		scope(timer)
+		{ }
+		void discard()
+		{ }
+	};
+
+	// Totals over all threads.
+	struct snapshot {
+		uint64_t count[counters] = {};
+		uint64_t time[timers][buckets] = {};
+		uint64_t secant[buckets] = {};
+		double residual = 0;
+
+		// Upper bound of bucket containing the p-th quantile of a histogram.
+		static double quantile(const uint64_t(&h)[buckets], double p)
+		{
+			uint64_t n = 0;
+			for (auto hi : h) {
+				n += hi;
+			}
+			if (n == 0) {
+				return 0;
+			}
+
+			uint64_t m = 0;
+			for (size_t i = 0; i < buckets; ++i) {
+				m += h[i];
+				if (m >= p * n) {
+					return i == 0 ? 0 : std::ldexp(1., static_cast<int>(i)) - 1;
+				}
+			}
+
+			return std::ldexp(1., buckets);
+		}
+	};
+
+	inline snapshot get()
+	{
+		snapshot s;
+
+		std::lock_guard lock(registry_mutex());
+		for (const auto& b : registry()) {
+			for (size_t i = 0; i < counters; ++i) {
+				s.count[i] += b->count[i].load(std::memory_order_relaxed);
+			}
+			for (size_t i = 0; i < timers; ++i) {
+				for (size_t j = 0; j < buckets; ++j) {
+					s.time[i][j] += b->time[i][j].load(std::memory_order_relaxed);
+				}
+			}
+			for (size_t j = 0; j < buckets; ++j) {
+				s.secant[j] += b->secant[j].load(std::memory_order_relaxed);
+			}
+			s.residual = std::max(s.residual, b->residual.load(std::memory_order_relaxed));
+		}
+
+		return s;
+	}
+
+	// Not exact if other threads are recording at the same time.
+	inline void reset()
+	{
+		std::lock_guard lock(registry_mutex());
+		for (const auto& b : registry()) {
+			for (auto& c : b->count) {
+				c.store(0, std::memory_order_relaxed);
+			}
+			for (auto& t : b->time) {
+				for (auto& h : t) {
+					h.store(0, std::memory_order_relaxed);
+				}
+			}
+			for (auto& h : b->secant) {
+				h.store(0, std::memory_order_relaxed);
+			}
+			b->residual.store(0, std::memory_order_relaxed);
+		}
+	}
+
+}
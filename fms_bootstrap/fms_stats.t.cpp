@@ -0,0 +1,85 @@
+// fms_stats.t.cpp - Test statistics. Counts are only recorded if FMS_STATS is defined.
+#include <cassert>
+#include <thread>
+#include "fms_bootstrap.h"
+#include "fms_instrument.h"
+
+using fms::sequence::list;
+
+int test_stats()
+{
+	using I = fms::instrument::sequence<list<double>, list<double>>;
+
+	fms::stats::reset();
+
+	I i[] = {
+		fms::instrument::flows(fms::instrument::cash_deposit(0.25, 0.04)),
+		fms::instrument::flows(fms::instrument::interest_rate_swap(1., 2, 0.05)),
+	};
+	double p[] = { 0, 0.01 };
+	auto F = fms::bootstrap::curve(2, i, p);
+	std::thread([&F]() { F.discount(0.5); }).join();
+
+	auto s = fms::stats::get();
+	if constexpr (fms::stats::enabled) {
+		assert(s.count[fms::stats::extend] == 2);
+		assert(s.count[fms::stats::closed_form] == 1);
+		assert(s.count[fms::stats::iterations] > 0);
+		assert(s.count[fms::stats::discount] >= 1);
+		assert(s.count[fms::stats::integral] >= s.count[fms::stats::discount]);
+		assert(s.residual < 1e-8);
+		assert(s.secant[0] == 1);
+		assert(fms::stats::snapshot::quantile(s.time[fms::stats::curve_ns], 0.5) > 0);
+
+		// fit has its own counters
+		uint64_t n = s.count[fms::stats::iterations];
+		fms::bootstrap::fit(2, i, p);
+		s = fms::stats::get();
+		assert(s.count[fms::stats::iterations] == n);
+		assert(s.count[fms::stats::fit] == 1);
+		assert(s.count[fms::stats::fit_iterations] > 0);
+		assert(fms::stats::snapshot::quantile(s.time[fms::stats::fit_ns], 0.5) > 0);
+
+		// number of curves timed
+		auto curves = [](const fms::stats::snapshot& s) {
+			uint64_t n = 0;
+			for (auto h : s.time[fms::stats::curve_ns]) {
+				n += h;
+			}
+			return n;
+		};
+		uint64_t c = curves(s);
+
+		// a cancelled curve is not timed
+		{
+			std::atomic<bool> cancel(true);
+			double t[2], f[2];
+			fms::bootstrap::curve(2, i, p, t, f, nullptr, &cancel);
+		}
+		assert(curves(fms::stats::get()) == c);
+
+		// a lazy build is timed by segment, not as a curve
+		uint64_t e = s.count[fms::stats::extend];
+		fms::bootstrap::lazy L(2, i, p);
+		L.build(1);
+		s = fms::stats::get();
+		assert(curves(s) == c);
+		assert(s.count[fms::stats::extend] == e + 2);
+
+		fms::stats::reset();
+		assert(fms::stats::get().count[fms::stats::extend] == 0);
+	}
+	else {
+		for (auto c : s.count) {
+			assert(c == 0);
+		}
+	}
+
+	assert(fms::stats::bucket(0) == 0);
+	assert(fms::stats::bucket(1) == 1);
+	assert(fms::stats::bucket(3) == 2);
+	assert(fms::stats::bucket(4) == 3);
+
+	return 0;
+}
+int test_stats_ = test_stats();
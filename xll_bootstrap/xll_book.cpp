@@ -0,0 +1,245 @@
+// xll_book.cpp - Excel add-in for books of trades created and priced in one call.
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "../fms_bootstrap/fms_bootstrap_book.h"
+#include "../fms_bootstrap/fms_instrument_book.h"
+#include "../xll12/xll/shfb/entities.h"
+#include "xll_bootstrap.h"
+
+#ifdef CATEGORY
+#undef CATEGORY
+#endif
+#define CATEGORY L"BOOK"
+
+using namespace xll;
+using fms::instrument::book;
+
+AddIn xai_book(
+	Document(CATEGORY)
+	.Category(CATEGORY)
+	.Documentation(
+		L"Functions for books of trades. A book holds many cash deposits, forward rate agreements, "
+		L"or swaps in columns behind one handle so a sheet with thousands of trades "
+		L"makes one add-in call to create them and one to price them. "
+	)
+);
+
+// Integer swap frequency. The bound also keeps the cast in range.
+inline int frequency(double f)
+{
+	ensure(f > 0 and f <= fms::instrument::schedule::max_frequency and f == std::floor(f));
+
+	return static_cast<int>(f);
+}
+
+AddIn xai_instrument_cash_deposits(
+	Function(XLL_HANDLE, L"?xll_instrument_cash_deposits", L"INSTRUMENT.CASH_DEPOSITS")
+	.Arg(XLL_FP, L"tenors", L"is an array of times in years at which the cash deposits mature.")
+	.Arg(XLL_FP, L"rates", L"is an array of simple compounding rates.")
+	.Uncalced()
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return a handle to a book of cash deposits.")
+	.Documentation(
+		L"Row i of the book is " C_(L"INSTRUMENT.CASH_DEPOSIT") L"(tenor_i, rate_i). "
+	)
+);
+HANDLEX WINAPI xll_instrument_cash_deposits(const _FP12* pt, const _FP12* pr)
+{
+#pragma XLLEXPORT
+	handlex result;
+
+	try {
+		ensure(size(*pt) == size(*pr));
+
+		handle<book> b(new book());
+		b->reserve(size(*pt));
+		for (int i = 0; i < size(*pt); ++i) {
+			b->add_cash_deposit(pt->array[i], pr->array[i]);
+		}
+
+		result = b.get();
+	}
+	catch (const std::exception & ex) {
+		XLL_ERROR(ex.what());
+
+		return 0; // #NUM!
+	}
+
+	return result;
+}
+
+AddIn xai_instrument_forward_rate_agreements(
+	Function(XLL_HANDLE, L"?xll_instrument_forward_rate_agreements", L"INSTRUMENT.FORWARD_RATE_AGREEMENTS")
+	.Arg(XLL_FP, L"effectives", L"is an array of times in years at which the forward rates start.")
+	.Arg(XLL_FP, L"tenors", L"is an array of times in years from effective to maturity.")
+	.Arg(XLL_FP, L"forwards", L"is an array of simple compounding forward rates.")
+	.Uncalced()
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return a handle to a book of forward rate agreements.")
+	.Documentation(
+		L"Row i of the book is " C_(L"INSTRUMENT.FORWARD_RATE_AGREEMENT") L"(effective_i, tenor_i, forward_i). "
+	)
+);
+HANDLEX WINAPI xll_instrument_forward_rate_agreements(const _FP12* pe, const _FP12* pt, const _FP12* pf)
+{
+#pragma XLLEXPORT
+	handlex result;
+
+	try {
+		ensure(size(*pe) == size(*pt));
+		ensure(size(*pe) == size(*pf));
+
+		handle<book> b(new book());
+		b->reserve(size(*pe));
+		for (int i = 0; i < size(*pe); ++i) {
+			b->add_forward_rate_agreement(pe->array[i], pt->array[i], pf->array[i]);
+		}
+
+		result = b.get();
+	}
+	catch (const std::exception & ex) {
+		XLL_ERROR(ex.what());
+
+		return 0; // #NUM!
+	}
+
+	return result;
+}
+
+AddIn xai_instrument_swaps(
+	Function(XLL_HANDLE, L"?xll_instrument_swaps", L"INSTRUMENT.SWAPS")
+	.Arg(XLL_FP, L"maturities", L"is an array of swap maturities in years.")
+	.Arg(XLL_FP, L"frequencies", L"is an array of positive integer coupon frequencies per year.")
+	.Arg(XLL_FP, L"coupons", L"is an array of swap coupons.")
+	.Uncalced()
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return a handle to a book of interest rate swaps.")
+	.Documentation(
+		L"Row i of the book is " C_(L"INSTRUMENT.INTEREST_RATE_SWAP") L"(maturity_i, frequency_i, coupon_i). "
+		L"Swaps with the same frequency share a coupon schedule and are priced together. "
+	)
+);
+HANDLEX WINAPI xll_instrument_swaps(const _FP12* pm, const _FP12* pq, const _FP12* pc)
+{
+#pragma XLLEXPORT
+	handlex result;
+
+	try {
+		ensure(size(*pm) == size(*pq));
+		ensure(size(*pm) == size(*pc));
+
+		handle<book> b(new book());
+		b->reserve(size(*pm));
+		for (int i = 0; i < size(*pm); ++i) {
+			b->add_interest_rate_swap(pm->array[i], frequency(pq->array[i]), pc->array[i]);
+		}
+
+		result = b.get();
+	}
+	catch (const std::exception & ex) {
+		XLL_ERROR(ex.what());
+
+		return 0; // #NUM!
+	}
+
+	return result;
+}
+
+AddIn xai_book_size(
+	Function(XLL_DOUBLE, L"?xll_book_size", CATEGORY L".SIZE")
+	.Arg(XLL_HANDLE, L"book", L"is a handle to a book.")
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return the number of trades in a book.")
+	.Documentation(
+		L"Return the number of trades in a book. "
+	)
+);
+double WINAPI xll_book_size(HANDLEX b)
+{
+#pragma XLLEXPORT
+	double result;
+
+	try {
+		handle<book> b_(b);
+
+		result = static_cast<double>(b_->size());
+	}
+	catch (const std::exception & ex) {
+		XLL_ERROR(ex.what());
+
+		return std::numeric_limits<double>::quiet_NaN();
+	}
+
+	return result;
+}
+
+AddIn xai_book_pv(
+	Function(XLL_DOUBLE, L"?xll_book_pv", CATEGORY L".PV")
+	.Arg(XLL_HANDLE, L"book", L"is a handle to a book.")
+	.Arg(XLL_HANDLE, L"curve", L"is a handle to a piecewise flat forward curve.")
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return the present value of all trades in a book.")
+	.Documentation(
+		L"Trades are priced in one pass over the book and the total does not depend "
+		L"on the number of threads used. "
+	)
+);
+double WINAPI xll_book_pv(HANDLEX b, HANDLEX f)
+{
+#pragma XLLEXPORT
+	double result;
+
+	try {
+		handle<book> b_(b);
+		handle<forward> f_(f);
+
+		std::vector<double> v(b_->size());
+		result = fms::bootstrap::book_pv(*f_, *b_, v.data());
+	}
+	catch (const std::exception & ex) {
+		XLL_ERROR(ex.what());
+
+		return std::numeric_limits<double>::quiet_NaN();
+	}
+
+	return result;
+}
+
+AddIn xai_book_pvs(
+	Function(XLL_FP, L"?xll_book_pvs", CATEGORY L".PVS")
+	.Arg(XLL_HANDLE, L"book", L"is a handle to a book.")
+	.Arg(XLL_HANDLE, L"curve", L"is a handle to a piecewise flat forward curve.")
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return a one column array of the present value of each trade in a book.")
+	.Documentation(
+		L"Row i is the present value of trade i in the order the book was created. "
+	)
+);
+_FP12* WINAPI xll_book_pvs(HANDLEX b, HANDLEX f)
+{
+#pragma XLLEXPORT
+	static xll::FP12 result;
+
+	try {
+		handle<book> b_(b);
+		handle<forward> f_(f);
+
+		int n = static_cast<int>(b_->size());
+		ensure(n > 0);
+		std::vector<double> v(n);
+		fms::bootstrap::book_pv(*f_, *b_, v.data());
+
+		result.resize(n, 1);
+		for (int i = 0; i < n; ++i) {
+			result[i] = v[i];
+		}
+	}
+	catch (const std::exception & ex) {
+		XLL_ERROR(ex.what());
+
+		return 0; // #NUM!
+	}
+
+	return result.get();
+}
@@ -1,5 +1,10 @@
 // xll_bootstrap.cpp - Excel add-in for bootstrapping piecewise constant forward curves.
+#include <numeric>
+#include <vector>
+#include "../fms_bootstrap/fms_bootstrap.h"
+#include "../xll12/xll/shfb/entities.h"
 #include "xll_bootstrap.h"
+#include "xll_instrument.h"
 
 using namespace xll;
 
@@ -9,4 +14,241 @@ AddIn xai_bootstrap(
     .Documentation(
         L"Excel add-in for bootstrapping piecewise constant forward curves."
     )
-);
\ No newline at end of file
+);
+
+// Curves bootstrapped from identical instruments and prices are not solved again.
+static fms::bootstrap::cache bootstrap_cache;
+
+using instrument_flows = fms::instrument::sequence<fms::sequence::list<double>, fms::sequence::list<double>>;
+
+// Cash flows of instrument handles.
+inline std::vector<instrument_flows> instruments(const _FP12& a)
+{
+	std::vector<instrument_flows> is;
+
+	is.reserve(size(a));
+	for (int i = 0; i < size(a); ++i) {
+		handle<xll::instrument<>> i_(a.array[i]);
+		is.push_back(i_->flows());
+	}
+
+	return is;
+}
+
+AddIn xai_bootstrap_curve(
+	Function(XLL_HANDLE, L"?xll_bootstrap_curve", CATEGORY L".CURVE")
+	.Arg(XLL_FP, L"instruments", L"is an array of handles to instruments with increasing maturities. ")
+	.Arg(XLL_FP, L"prices", L"is an array of instrument prices. ")
+	.Uncalced()
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return a handle to a piecewise flat forward curve that reprices the instruments. ")
+	.Documentation(
+		L"Bootstrap a piecewise flat forward curve in one call. "
+		L"Each instrument extends the curve to its last cash flow time. "
+		L"The handle can be used with the " C_(L"PWFLAT.FORWARD") L" functions. "
+		L"Curves are cached by instrument cash flows and prices so recalculating "
+		L"with the same inputs does not bootstrap again. See " C_(L"BOOTSTRAP.CACHE") L". "
+	)
+);
+HANDLEX WINAPI xll_bootstrap_curve(const _FP12* pi, const _FP12* pp)
+{
+#pragma XLLEXPORT
+	handlex result;
+
+	try {
+		ensure(size(*pi) == size(*pp));
+
+		auto is = instruments(*pi);
+		auto f = bootstrap_cache.curve(is.size(), is.data(), pp->array);
+		handle<forward> forward_(new forward(*f));
+
+		result = forward_.get();
+	}
+	catch (const std::exception & ex) {
+		XLL_ERROR(ex.what());
+
+		return 0; // #NUM!
+	}
+
+	return result;
+}
+
+AddIn xai_bootstrap_curve_diagnostics(
+	Function(XLL_FP, L"?xll_bootstrap_curve_diagnostics", CATEGORY L".CURVE.DIAGNOSTICS")
+	.Arg(XLL_FP, L"instruments", L"is an array of handles to instruments with increasing maturities. ")
+	.Arg(XLL_FP, L"prices", L"is an array of instrument prices. ")
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return a four column array of time, forward, iterations and residual for each segment. ")
+	.Documentation(
+		L"Bootstrap the curve as in " C_(L"BOOTSTRAP.CURVE") L" and report solver diagnostics. "
+		L"Iterations are the number of secant steps, 0 if the segment was solved in closed form. "
+		L"The residual is the price minus the present value of the instrument on the curve. "
+	)
+);
+_FP12* WINAPI xll_bootstrap_curve_diagnostics(const _FP12* pi, const _FP12* pp)
+{
+#pragma XLLEXPORT
+	static xll::FP12 result;
+
+	try {
+		ensure(size(*pi) == size(*pp));
+
+		auto is = instruments(*pi);
+		std::vector<fms::bootstrap::diagnostic> d(is.size());
+		bootstrap_cache.curve(is.size(), is.data(), pp->array, d.data());
+
+		result.resize(static_cast<int>(d.size()), 4);
+		for (int i = 0; i < static_cast<int>(d.size()); ++i) {
+			result[4 * i + 0] = d[i].time;
+			result[4 * i + 1] = d[i].forward;
+			result[4 * i + 2] = d[i].iterations;
+			result[4 * i + 3] = d[i].residual;
+		}
+	}
+	catch (const std::exception & ex) {
+		XLL_ERROR(ex.what());
+
+		return 0; // #NUM!
+	}
+
+	return result.get();
+}
+
+AddIn xai_bootstrap_fit(
+	Function(XLL_HANDLE, L"?xll_bootstrap_fit", CATEGORY L".FIT")
+	.Arg(XLL_FP, L"instruments", L"is an array of handles to instruments. ")
+	.Arg(XLL_FP, L"prices", L"is an array of instrument prices. ")
+	.Uncalced()
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return a handle to a piecewise flat forward curve fit to the instruments by least squares. ")
+	.Documentation(
+		L"Knots are placed at the distinct last cash flow times of the instruments and all "
+		L"forwards are solved for at once. Unlike " C_(L"BOOTSTRAP.CURVE") L" instruments "
+		L"may share maturities or overlap and need not be sorted. "
+		L"Inconsistent prices are fit in the least squares sense. "
+	)
+);
+HANDLEX WINAPI xll_bootstrap_fit(const _FP12* pi, const _FP12* pp)
+{
+#pragma XLLEXPORT
+	handlex result;
+
+	try {
+		ensure(size(*pi) == size(*pp));
+
+		auto is = instruments(*pi);
+		handle<forward> forward_(new forward(fms::bootstrap::fit(is.size(), is.data(), pp->array)));
+
+		result = forward_.get();
+	}
+	catch (const std::exception & ex) {
+		XLL_ERROR(ex.what());
+
+		return 0; // #NUM!
+	}
+
+	return result;
+}
+
+AddIn xai_bootstrap_cache(
+	Function(XLL_FP, L"?xll_bootstrap_cache", CATEGORY L".CACHE")
+	.Arg(XLL_DOUBLE, L"capacity", L"is the optional maximum number of cached curves. ")
+	.Volatile()
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return a one row array of capacity, size, hits and misses of the curve cache. ")
+	.Documentation(
+		L"Curves are evicted least recently used first when the cache is full. "
+		L"If " C_(L"capacity") L" is positive it sets the maximum number of cached curves. "
+		L"If it is negative the cache is disabled and cleared. "
+		L"The default capacity is 64. "
+	)
+);
+_FP12* WINAPI xll_bootstrap_cache(double capacity)
+{
+#pragma XLLEXPORT
+	static xll::FP12 result(1, 4);
+
+	try {
+		if (capacity > 0) {
+			bootstrap_cache.capacity(static_cast<size_t>(capacity));
+		}
+		else if (capacity < 0) {
+			bootstrap_cache.capacity(0);
+		}
+
+		result[0] = static_cast<double>(bootstrap_cache.capacity());
+		result[1] = static_cast<double>(bootstrap_cache.size());
+		result[2] = static_cast<double>(bootstrap_cache.hits());
+		result[3] = static_cast<double>(bootstrap_cache.misses());
+	}
+	catch (const std::exception & ex) {
+		XLL_ERROR(ex.what());
+
+		return 0; // #NUM!
+	}
+
+	return result.get();
+}
+
+AddIn xai_bootstrap_stats(
+	Function(XLL_LPOPER, L"?xll_bootstrap_stats", CATEGORY L".STATS")
+	.Arg(XLL_BOOL, L"reset", L"is an optional boolean indicating the statistics should be reset after they are returned. ")
+	.Volatile()
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return a two column array of names and values of curve and bootstrap statistics. ")
+	.Documentation(
+		L"Statistics are collected only if the add-in is compiled with " C_(L"FMS_STATS=1") L". "
+		L"Counts are totals over all threads since the last reset. "
+		L"Times are upper bounds in nanoseconds from power of 2 histograms. "
+	)
+);
+LPOPER WINAPI xll_bootstrap_stats(BOOL reset)
+{
+#pragma XLLEXPORT
+	static OPER result;
+
+	try {
+		using namespace fms::stats;
+
+		auto s = get();
+		const auto& q = snapshot::quantile;
+
+		result = OPER(19, 2);
+		int i = 0;
+		auto row = [&i](const wchar_t* name, double value) {
+			result(i, 0) = name;
+			result(i, 1) = value;
+			++i;
+		};
+		row(L"enabled", enabled);
+		row(L"discount", static_cast<double>(s.count[discount]));
+		row(L"integral", static_cast<double>(s.count[integral]));
+		row(L"pv", static_cast<double>(s.count[pv]));
+		row(L"extend", static_cast<double>(s.count[extend]));
+		row(L"closed_form", static_cast<double>(s.count[closed_form]));
+		row(L"iterations", static_cast<double>(s.count[iterations]));
+		row(L"iterations_p50", q(s.secant, 0.5));
+		row(L"iterations_max", q(s.secant, 1));
+		row(L"residual_max", s.residual);
+		row(L"extend_ns_p50", q(s.time[extend_ns], 0.5));
+		row(L"extend_ns_p99", q(s.time[extend_ns], 0.99));
+		row(L"curve_ns_p50", q(s.time[curve_ns], 0.5));
+		row(L"curve_ns_p99", q(s.time[curve_ns], 0.99));
+		row(L"curves", static_cast<double>(std::accumulate(std::begin(s.time[curve_ns]), std::end(s.time[curve_ns]), uint64_t(0))));
+		row(L"fit", static_cast<double>(s.count[fit]));
+		row(L"fit_iterations", static_cast<double>(s.count[fit_iterations]));
+		row(L"fit_ns_p50", q(s.time[fit_ns], 0.5));
+		row(L"fit_ns_p99", q(s.time[fit_ns], 0.99));
+
+		if (reset) {
+			fms::stats::reset();
+		}
+	}
+	catch (const std::exception & ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return &result;
+}
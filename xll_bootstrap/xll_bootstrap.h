@@ -2,6 +2,7 @@
 #pragma once
 #include <utility>
 #include "../fms_sequence/fms_sequence_list.h"
+#include "../fms_bootstrap/fms_pwflat.h"
 #include "../xll12/xll/xll.h"
 
 #ifndef CATEGORY
@@ -16,4 +17,7 @@ namespace xll {
 		return fms::sequence::list(size(a), a.array);
 	}
 
+	// Curves returned by PWFLAT.FORWARD and BOOTSTRAP.CURVE.
+	using forward = fms::pwflat::forward<fms::sequence::list<double>, fms::sequence::list<double>>;
+
 }
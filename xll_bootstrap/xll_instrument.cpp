@@ -184,6 +184,8 @@ HANDLEX WINAPI xll_instrument_swap(double maturity, double frequency, double cou
 	handlex result;
 
 	try {
+		ensure(maturity <= fms::instrument::schedule::max_maturity);
+		ensure(frequency > 0 and frequency <= fms::instrument::schedule::max_frequency);
 		auto swa = fms::instrument::interest_rate_swap(maturity, frequency, coupon);
 		handle<xll::instrument<>> swa_(new instrument_impl(swa));
 
@@ -1,6 +1,9 @@
 // xll_intrument.h - Virtual interface to instruments.
 #pragma once
+#include <memory>
 #include <utility>
+#include "../fms_sequence/fms_sequence_list.h"
+#include "../fms_bootstrap/fms_instrument_sequence.h"
 
 namespace xll {
 
@@ -21,10 +24,25 @@ namespace xll {
 		{
 			return op_incr();
 		}
+		// Remaining cash flows as lists of times and amounts.
+		auto flows() const
+		{
+			fms::sequence::list<T> u;
+			fms::sequence::list<C> c;
+
+			for (auto i = op_clone(); *i; ++*i) {
+				const auto& [u_, c_] = **i;
+				u.push_back(u_);
+				c.push_back(c_);
+			}
+
+			return fms::instrument::sequence(u, c);
+		}
 	private:
 		virtual bool op_bool() const = 0;
 		virtual std::pair<T, C> op_star() const = 0;
 		virtual instrument& op_incr() = 0;
+		virtual std::unique_ptr<instrument> op_clone() const = 0;
 	};
 
 	// This class knows the actual instrument type.
@@ -49,6 +67,10 @@ namespace xll {
 
 			return *this;
 		}
+		std::unique_ptr<instrument<>> op_clone() const override
+		{
+			return std::make_unique<instrument_impl>(i);
+		}
 	};
 
 }
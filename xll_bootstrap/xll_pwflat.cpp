@@ -1,5 +1,11 @@
 // xll_pwflat.cpp - Excel add-in for piecewise flat forward curves.
+#include <algorithm>
+#include <vector>
 #include "../fms_bootstrap/fms_pwflat.h"
+#include "../fms_bootstrap/fms_pwflat_compress.h"
+#include "../fms_bootstrap/fms_pwflat_grid.h"
+#include "../fms_bootstrap/fms_pwflat_plan.h"
+#include "../xll12/xll/shfb/entities.h"
 #include "xll_bootstrap.h"
 
 #ifdef CATEGORY
@@ -17,8 +23,6 @@ AddIn xai_pwflat(
 	)
 );
 
-using forward = fms::pwflat::forward<fms::sequence::list<double>, fms::sequence::list<double>>;
-
 AddIn xai_pwflat_forward(
 	Function(XLL_HANDLE, L"?xll_pwflat_forward", CATEGORY L".FORWARD")
 	.Arg(XLL_FP, L"time", L"is an array of times. ")
@@ -150,3 +154,205 @@ _FP12* WINAPI xll_pwflat_forward_discount(HANDLEX fwd, const _FP12* pt)
 
 	return result.get();
 }
+
+AddIn xai_pwflat_forward_grid(
+	Function(XLL_FP, L"?xll_pwflat_forward_grid", CATEGORY L".FORWARD.GRID")
+	.Arg(XLL_HANDLE, L"forward", L"is a handle to a piecewise flat forward. ")
+	.Arg(XLL_DOUBLE, L"start", L"is the first time of the grid. ")
+	.Arg(XLL_DOUBLE, L"step", L"is the positive time between grid points. ")
+	.Arg(XLL_LONG, L"count", L"is the number of grid points. ")
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return a four column array of time, forward, spot and discount on a uniform grid. ")
+	.Documentation(
+		L"The grid times are " C_(L"start") L" + j " C_(L"step") L" for j = 0, ..., " C_(L"count") L" - 1. "
+		L"Discounts are computed by multiplying by exp(-f " C_(L"step") L") within each segment "
+		L"instead of calling exp at every point. "
+	)
+);
+_FP12* WINAPI xll_pwflat_forward_grid(HANDLEX fwd, double start, double step, LONG count)
+{
+#pragma XLLEXPORT
+	static xll::FP12 result;
+
+	try {
+		ensure(step > 0);
+		ensure(count > 0);
+
+		handle<forward> fwd_(fwd);
+
+		std::vector<double> v(count), r(count), D(count);
+		fms::pwflat::grid(*fwd_, start, step, count, v.data(), r.data(), D.data());
+
+		result.resize(count, 4);
+		for (LONG j = 0; j < count; ++j) {
+			result[4 * j + 0] = start + j * step;
+			result[4 * j + 1] = v[j];
+			result[4 * j + 2] = r[j];
+			result[4 * j + 3] = D[j];
+		}
+	}
+	catch (const std::exception & ex) {
+		XLL_ERROR(ex.what());
+
+		return 0; // #NUM!
+	}
+
+	return result.get();
+}
+
+AddIn xai_pwflat_forward_compress(
+	Function(XLL_HANDLE, L"?xll_pwflat_forward_compress", CATEGORY L".FORWARD.COMPRESS")
+	.Arg(XLL_HANDLE, L"forward", L"is a handle to a piecewise flat forward. ")
+	.Arg(XLL_DOUBLE, L"tolerance", L"is the largest allowed difference in discount. ")
+	.Arg(XLL_FP, L"pillars", L"is an optional increasing array of times where the integral must be exact. ")
+	.Uncalced()
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return a handle to a curve with adjacent segments merged. ")
+	.Documentation(
+		L"Adjacent segments are replaced by their average forward while the discount stays within "
+		C_(L"tolerance") L" of the original at all times. The integral of the forward is exact at "
+		L"every knot of the result and at the " C_(L"pillars") L". "
+	)
+);
+HANDLEX WINAPI xll_pwflat_forward_compress(HANDLEX fwd, double tolerance, const _FP12* pp)
+{
+#pragma XLLEXPORT
+	handlex result;
+
+	try {
+		ensure(tolerance >= 0);
+
+		handle<forward> fwd_(fwd);
+		std::vector<double> p(pp->array, pp->array + size(*pp));
+		std::sort(p.begin(), p.end());
+		p.erase(std::unique(p.begin(), p.end()), p.end());
+
+		handle<forward> compress_(new forward(fms::pwflat::compress(*fwd_, p.size(), p.data(), tolerance)));
+
+		result = compress_.get();
+	}
+	catch (const std::exception & ex) {
+		XLL_ERROR(ex.what());
+
+		return 0; // #NUM!
+	}
+
+	return result;
+}
+
+// Plan that remembers the shape of the times.
+struct pwflat_plan : public fms::pwflat::plan {
+	int r, c;
+	template<class T>
+	pwflat_plan(T t, const _FP12& u)
+		: fms::pwflat::plan(t, ::size(u), u.array), r(::rows(u)), c(::columns(u))
+	{ }
+};
+
+AddIn xai_pwflat_plan(
+	Function(XLL_HANDLE, L"?xll_pwflat_plan", CATEGORY L".PLAN")
+	.Arg(XLL_HANDLE, L"forward", L"is a handle to a piecewise flat forward having the knot times to use. ")
+	.Arg(XLL_FP, L"times", L"is an array of times at which to evaluate curves. ")
+	.Uncalced()
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return a handle to a plan for evaluating curves with the same knot times. ")
+	.Documentation(
+		L"Locate each of the " C_(L"times") L" against the knot times of " C_(L"forward") L" once. "
+		L"The " C_(L"PWFLAT.PLAN") L" functions then evaluate any curve having the same knot times "
+		L"without searching. This is the case for curves bootstrapped from the same instruments. "
+	)
+);
+HANDLEX WINAPI xll_pwflat_plan(HANDLEX fwd, const _FP12* pt)
+{
+#pragma XLLEXPORT
+	handlex result;
+
+	try {
+		handle<forward> fwd_(fwd);
+		handle<pwflat_plan> plan_(new pwflat_plan(fwd_->time(), *pt));
+
+		result = plan_.get();
+	}
+	catch (const std::exception & ex) {
+		XLL_ERROR(ex.what());
+
+		return 0; // #NUM!
+	}
+
+	return result;
+}
+
+// Evaluate curve using plan.
+template<class E>
+inline _FP12* pwflat_plan_evaluate(HANDLEX plan, HANDLEX fwd, xll::FP12& result, E e)
+{
+	try {
+		handle<pwflat_plan> plan_(plan);
+		handle<forward> fwd_(fwd);
+		ensure(plan_->layout(*fwd_) || !"PWFLAT.PLAN: curve knot times do not match plan");
+
+		result.resize(plan_->r, plan_->c);
+		e(*plan_, *fwd_, &result[0]);
+	}
+	catch (const std::exception & ex) {
+		XLL_ERROR(ex.what());
+
+		return 0; // #NUM!
+	}
+
+	return result.get();
+}
+
+AddIn xai_pwflat_plan_value(
+	Function(XLL_FP, L"?xll_pwflat_plan_value", CATEGORY L".PLAN.VALUE")
+	.Arg(XLL_HANDLE, L"plan", L"is a handle returned by " CATEGORY L".PLAN. ")
+	.Arg(XLL_HANDLE, L"forward", L"is a handle to a piecewise flat forward. ")
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return forward values at the plan times. ")
+	.Documentation(
+		L"Same as " C_(L"PWFLAT.FORWARD.VALUE") L" at the plan times. "
+	)
+);
+_FP12* WINAPI xll_pwflat_plan_value(HANDLEX plan, HANDLEX fwd)
+{
+#pragma XLLEXPORT
+	static xll::FP12 result;
+
+	return pwflat_plan_evaluate(plan, fwd, result, [](const auto& p, const auto& f, double* v) { p.value(f, v); });
+}
+
+AddIn xai_pwflat_plan_spot(
+	Function(XLL_FP, L"?xll_pwflat_plan_spot", CATEGORY L".PLAN.SPOT")
+	.Arg(XLL_HANDLE, L"plan", L"is a handle returned by " CATEGORY L".PLAN. ")
+	.Arg(XLL_HANDLE, L"forward", L"is a handle to a piecewise flat forward. ")
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return forward spots at the plan times. ")
+	.Documentation(
+		L"Same as " C_(L"PWFLAT.FORWARD.SPOT") L" at the plan times. "
+	)
+);
+_FP12* WINAPI xll_pwflat_plan_spot(HANDLEX plan, HANDLEX fwd)
+{
+#pragma XLLEXPORT
+	static xll::FP12 result;
+
+	return pwflat_plan_evaluate(plan, fwd, result, [](const auto& p, const auto& f, double* v) { p.spot(f, v); });
+}
+
+AddIn xai_pwflat_plan_discount(
+	Function(XLL_FP, L"?xll_pwflat_plan_discount", CATEGORY L".PLAN.DISCOUNT")
+	.Arg(XLL_HANDLE, L"plan", L"is a handle returned by " CATEGORY L".PLAN. ")
+	.Arg(XLL_HANDLE, L"forward", L"is a handle to a piecewise flat forward. ")
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return forward discounts at the plan times. ")
+	.Documentation(
+		L"Same as " C_(L"PWFLAT.FORWARD.DISCOUNT") L" at the plan times. "
+	)
+);
+_FP12* WINAPI xll_pwflat_plan_discount(HANDLEX plan, HANDLEX fwd)
+{
+#pragma XLLEXPORT
+	static xll::FP12 result;
+
+	return pwflat_plan_evaluate(plan, fwd, result, [](const auto& p, const auto& f, double* v) { p.discount(f, v); });
+}